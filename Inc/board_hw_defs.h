@@ -199,9 +199,11 @@ typedef struct{
 
 typedef struct{
     ADC_HandleTypeDef       *hadc;
+    ADC_HandleTypeDef       *hadcSlave;     //非空时与hadc组成双ADC同步采样,sConfig[1]接到从ADC
     DMA_HandleTypeDef       *hdma;
     bool                    irq_enabled;
     STM32_IRQ_CFG           dmairq;
+    STM32_IRQ_CFG           adcirq;         //主ADC转换完成中断
     uint8_t                 channelNum;
     ADC_ChannelConfTypeDef  sConfig[3];
     STM32_GPIO              ADCGpio[3];
@@ -0,0 +1,13 @@
+/*
+ * fastmem.h
+ *
+ *  电流环热路径放出flash:代码进SRAM(.ramfunc),数据进CCM(.ccmram),CCM不能取指和DMA
+ */
+
+#ifndef FASTMEM_H_
+#define FASTMEM_H_
+
+#define FAST_CODE	__attribute__((section(".ramfunc")))
+#define FAST_DATA	__attribute__((section(".ccmram")))
+
+#endif /* FASTMEM_H_ */
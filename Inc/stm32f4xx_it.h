@@ -55,6 +55,7 @@ void UsageFault_Handler(void);
 void DebugMon_Handler(void);
 void SysTick_Handler(void);
 void DMA2_Stream0_IRQHandler(void);
+void ADC_IRQHandler(void);
 
 #ifdef __cplusplus
 }
@@ -5,6 +5,7 @@
  *      Author: baron
  */
 #include "myMath.h"
+#include "fastmem.h"
 
 /////////////////////////////////////////////////////////    
 //功能：十进制转BCD码  //  
@@ -63,13 +64,183 @@ float RCLowPass(float newDat,float oldDat,float f0,float Ts)
 unsigned char CalculateCheckSum(unsigned char *p,int len)
 {
     unsigned char checksum = 0;
-    for(unsigned char i = 0;i<len;i++)
+    for(int i = 0;i<len;i++)
     {
         checksum+=p[i];
     }
     return checksum;
 }
 
+extern const int16_t sinArrayQ15[1025];
+
+/*
+ * 查表求sin,angle 0-4095对应0-2*pi,表为1/4周期,无插值
+ * 相对sin(angle*2*pi/4096)最大误差1.48LSB(表按32767量化,Tools/Host/trig实测)
+ */
+FAST_CODE Q15 SinQ15(uint16_t angle)
+{
+	uint16_t index = angle & (VALUE_Q10 - 1);
+	switch((angle >> 10) & 0x03)
+	{
+		case 0:		return sinArrayQ15[index];
+		case 1:		return sinArrayQ15[VALUE_Q10 - index];
+		case 2:		return -sinArrayQ15[index];
+		default:	return -sinArrayQ15[VALUE_Q10 - index];
+	}
+}
+
+FAST_CODE Q15 CosQ15(uint16_t angle)
+{
+	return SinQ15(angle + VALUE_Q10);
+}
+
+FAST_CODE void SinCosQ15(uint16_t angle,Q15 *sinVal,Q15 *cosVal)
+{
+	*sinVal = SinQ15(angle);
+	*cosVal = SinQ15(angle + VALUE_Q10);
+}
+
+/*
+ * 查表+线性插值,angle 0-65535对应0-2*pi,高12位与SvpwmDriverRad的4096步一致
+ */
+static Q15 SinQ15Interp(uint16_t angle)
+{
+	uint16_t pos = angle & 0x3FFF;
+	uint16_t index;
+	int32_t y0,y1,out;
+
+	if(angle & 0x4000)
+		pos = 0x4000 - pos;
+	index = pos >> 4;
+	y0 = sinArrayQ15[index];
+	y1 = sinArrayQ15[index < VALUE_Q10 ? index + 1 : VALUE_Q10];
+	out = y0 + (((y1 - y0)*(pos & 0x0F) + 8) >> 4);
+	return (angle & 0x8000) ? -out : out;
+}
+
+void SinCosQ15Fine(uint16_t angle,Q15 *sinVal,Q15 *cosVal)
+{
+	*sinVal = SinQ15Interp(angle);
+	*cosVal = SinQ15Interp(angle + 0x4000);
+}
+
+/*
+ * 浮点版本,与Q15共用一张表,弧度输入任意范围(|rad| < 2^24/4096*2*pi)
+ */
+static float SinFastQuarter(float pos)
+{
+	int32_t index = (int32_t)pos;
+	float frac = pos - index;
+	float y0 = sinArrayQ15[index];
+	float y1 = sinArrayQ15[index < VALUE_Q10 ? index + 1 : VALUE_Q10];
+	return (y0 + (y1 - y0)*frac)*(1.0f/32767);
+}
+
+static float SinFastSteps(float steps)
+{
+	int32_t whole = (int32_t)steps;
+	float pos;
+	float out;
+
+	if(steps < whole)
+		whole--;
+	pos = (whole & (VALUE_Q10 - 1)) + (steps - whole);
+	if(whole & VALUE_Q10)
+		pos = VALUE_Q10 - pos;
+	out = SinFastQuarter(pos);
+	return (whole & (VALUE_Q10<<1)) ? -out : out;
+}
+
+float SinFast(float rad)
+{
+	return SinFastSteps(rad*(VALUE_Q12/(2*3.14159265f)));
+}
+
+float CosFast(float rad)
+{
+	return SinFastSteps(rad*(VALUE_Q12/(2*3.14159265f)) + VALUE_Q10);
+}
+
+void SinCosFast(float rad,float *sinVal,float *cosVal)
+{
+	float steps = rad*(VALUE_Q12/(2*3.14159265f));
+	*sinVal = SinFastSteps(steps);
+	*cosVal = SinFastSteps(steps + VALUE_Q10);
+}
+
+/*
+ * atan2多项式近似(Abramowitz & Stegun 4.4.49),先折叠到|z|<=1
+ */
+FAST_CODE float Atan2Fast(float y,float x)
+{
+	float ax = fabsf(x),ay = fabsf(y);
+	float z,z2,out;
+
+	if(ax == 0 && ay == 0)
+		return 0;
+	z = ay > ax ? ax/ay : ay/ax;
+	z2 = z*z;
+	out = z*(0.9998660f + z2*(-0.3302995f + z2*(0.1801410f + z2*(-0.0851330f + z2*0.0208351f))));
+	if(ay > ax)
+		out = 1.57079633f - out;
+	if(x < 0)
+		out = 3.14159265f - out;
+	return y < 0 ? -out : out;
+}
+
+/*
+ * CORDIC矢量模式求atan2,结果0-4095对应0-2*pi(与SvpwmDriverRad一致)
+ * 内部角度单位2^28/圈,14次迭代,最大误差<0.5LSB(0.044度)
+ * 纯整数运算,主机与目标板结果逐位一致
+ */
+static const int32_t atan2Q12Table[] = {
+	33554432,19808338,10466182,5312797,2666708,1334654,667490,
+	333765,166885,83443,41722,20861,10430,5215,
+};
+
+FAST_CODE uint16_t Atan2Q12(int32_t y,int32_t x)
+{
+	int32_t angle = 0,xn;
+	uint32_t m;
+	uint8_t sh;
+
+	if(x == 0 && y == 0)
+		return 0;
+	//-INT32_MIN溢出,两个都右移一位,角度不变
+	if(x == INT32_MIN || y == INT32_MIN)
+	{
+		x >>= 1;
+		y >>= 1;
+	}
+	if(x < 0)
+	{
+		x = -x;
+		y = -y;
+		angle = 1<<27;
+	}
+	m = x > (y < 0 ? -y : y) ? x : (y < 0 ? -y : y);
+	sh = __builtin_clz(m);
+	if(sh > 3)
+	{
+		x *= 1<<(sh - 3);
+		y *= 1<<(sh - 3);
+	}else if(sh < 3)
+	{
+		x >>= 3 - sh;
+		y >>= 3 - sh;
+	}
+	//无分支迭代:y>=0时s=0顺时针旋转,y<0时s=-1取反为逆时针
+	for(uint8_t i = 0;i<NELEMENTS(atan2Q12Table);i++)
+	{
+		int32_t s = y>>31;
+		xn = x + (((y>>i) ^ s) - s);
+		y -= ((x>>i) ^ s) - s;
+		angle += (atan2Q12Table[i] ^ s) - s;
+		x = xn;
+	}
+	return ((angle + (1<<15))>>16) & (VALUE_Q12 - 1);
+}
+
 DECLARE_SimpleRCLowPassFilter(1)
 DECLARE_SimpleRCLowPassFilter(2)
 DECLARE_SimpleRCLowPassFilter(10)
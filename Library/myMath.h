@@ -85,6 +85,25 @@
 
 float RCLowPass(float newDat,float oldDat,float f0,float Ts);
 
+/*
+ * 三角函数,角度统一为4096步一圈(与SvpwmDriverRad一致),共用sinArray.c的1/4周期Q15表
+ * 最大误差由Tools/Host/trig测得:
+ *	SinQ15/CosQ15/SinCosQ15		angle 0-4095,无插值		1.48LSB(表按32767量化)
+ *	SinCosQ15Fine				angle 0-65535,线性插值	<=2LSB
+ *	SinFast/CosFast/SinCosFast	弧度,线性插值				<=1.6e-5
+ *	Atan2Fast					弧度(-pi,pi],多项式		<=1.2e-5 rad
+ *	Atan2Q12					0-4095,CORDIC				<=0.7步(含输入取整)
+ */
+uint16_t Atan2Q12(int32_t y,int32_t x);
+Q15 SinQ15(uint16_t angle);
+Q15 CosQ15(uint16_t angle);
+void SinCosQ15(uint16_t angle,Q15 *sinVal,Q15 *cosVal);
+void SinCosQ15Fine(uint16_t angle,Q15 *sinVal,Q15 *cosVal);
+float SinFast(float rad);
+float CosFast(float rad);
+void SinCosFast(float rad,float *sinVal,float *cosVal);
+float Atan2Fast(float y,float x);
+
 void LSM_Plus(double X,double Y,double* SUMX,double* SUMX2,double* SUMY,double* SUMXY,double* SUMY2);
 
 void LSM_Output(double N,double SUMX,double SUMX2,double SUMY,double SUMXY,double SUMY2,float* K,float* B,float* R );
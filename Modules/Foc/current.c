@@ -3,15 +3,31 @@
 #include <math.h>
 #include "timer.h"
 #include "motordriver.h"
+#include "svpwm.h"
+#include "myMath.h"
+#include "fastmem.h"
+#include "isrprofile.h"
+#include "motion.h"
+#include "startup.h"
+#include "hfi.h"
 
-adc_result_type adc_result;
-sysFbkVals motor_fbk;
-sysEstimateVals motor_Estimate;
-MotorParamVars motor;
+adc_result_type adc_result FAST_DATA;
+sysFbkVals motor_fbk FAST_DATA;
+sysEstimateVals motor_Estimate FAST_DATA;
+MotorParamVars motor FAST_DATA;
+sysFocCtrlVals motor_foc FAST_DATA;
+SmoQ15 motor_smo FAST_DATA;
+DeadTimeComp motor_dtc FAST_DATA;
+MotorIdent motor_ident FAST_DATA;
+MotionCtrl motor_motion FAST_DATA;
+MotorStartup motor_startup FAST_DATA;
+Hfi motor_hfi FAST_DATA;
 
 void MotorInit(void)
 {
 	adc_result.haszero = false;
+	adc_result.shunt_skip = MotorPhase3;
+	adc_result.shunt_next = MotorPhase3;
 	motor_fbk.I_fbk_factor = 0.000805664f;
 	motor_Estimate.Klsf = 0.1f;
 	motor_Estimate.kctrl = 0.01f;
@@ -21,30 +37,201 @@ void MotorInit(void)
 	motor.Motor_Rs_pu = MOTOR_RS;// / R_base;
 	motor.Motor_Ld_pu = MOTOR_LD;// / L_base;
 	motor.Motor_Lq_pu = MOTOR_LQ;// / L_base;
+	motor.Motor_Flux = MOTOR_FLUX;
+	motor_Estimate.Pll_Kp = 2*0.707f*2*PI*SMO_PLL_BW_HZ;
+	motor_Estimate.Pll_Ki = (2*PI*SMO_PLL_BW_HZ)*(2*PI*SMO_PLL_BW_HZ)*motor.pwm_Ts;
+	motor_Estimate.Theta_estimate = 0;
+	motor_Estimate.Theta_comp = 0;
+	motor_Estimate.Omega_estimate = 0;
+	motor_foc.Bandwidth = CURRENT_LOOP_BW_HZ;
+	MotionInit(&motor_motion);
+	MotorStartupInit(&motor_startup);
+	HfiInit(&motor_hfi);
+	MotorParamUpdate();
+	IsrProfileInit(SystemCoreClock/PWM_FREQUENCE_VAL);
+	DeadTimeCompInit(&motor_dtc,DEADTIME_COMP_NS,DEADTIME_COMP_VDROP,DEADTIME_COMP_IBAND,PWM_FREQUENCE_VAL);
+
+	motor_fbk.Vbus = VDC_BUS;
+	motor_fbk.Vbus_k = 2*PI*VBUS_FILTER_HZ*motor.pwm_Ts;
+	CurrentBusVoltageUpdate();
+	motor_foc.fw.Enable = true;
+	motor_foc.fw.Ratio = FW_U_RATIO;
+	motor_foc.fw.Ki = FW_KI;
+	motor_foc.fw.IdMin = FW_ID_MIN;
+	motor_foc.Imax = CURRENT_LOOP_I_MAX;
+	motor_foc.Decouple = CURRENT_DECOUPLE;
+	motor_foc.ThetaSource = FocThetaSource_OpenLoop;
+	motor_foc.ThetaStep = OPENLOOP_THETA_STEP;
+	motor_foc.Id_ref = OPENLOOP_ID_REF;
+	motor_foc.Iq_ref = 0;
+	CurrentLoopReset();
+	motor_foc.Enable = true;
+}
+
+/*
+ *	由motor里的Rs/Ld/Lq重算观测器系数和电流环PI,参数辨识完成后同样调用
+ *	定点观测器会清零状态,电机转动时调用要等观测器重新收敛
+ */
+void MotorParamUpdate(void)
+{
 	//Fctrl = 1 - R*Ts/L
 	motor_Estimate.Fctrl = (1 - (motor.Motor_Rs_pu * motor.pwm_Ts) / motor.Motor_Ld_pu);
 	//Gctrl = Ts/Ls
 	motor_Estimate.Gctrl = motor.pwm_Ts / motor.Motor_Ld_pu;
+	SmoQ15Init(&motor_smo,motor.Motor_Rs_pu,motor.Motor_Ld_pu,motor.pwm_Ts,motor_Estimate.kctrl,motor_Estimate.Klsf,SMO_U_BASE,SMO_I_BASE);
+	SmoQ15PllInit(&motor_smo,SMO_PLL_BW_HZ,SMO_PLL_E_MIN,motor.pwm_Ts,SMO_U_BASE);
+	motor_Estimate.Lag_Ti = motor.Motor_Ld_pu / (motor.Motor_Rs_pu + motor_Estimate.kctrl) - motor.pwm_Ts;
+	motor_Estimate.Lag_Tf = motor.pwm_Ts * (1 - motor_Estimate.Klsf) / motor_Estimate.Klsf;
+	motor_Estimate.Ldq = motor.Motor_Ld_pu - motor.Motor_Lq_pu;
+
+	CurrentLoopGainUpdate();
+	MotionGainUpdate(&motor_motion);
+	HfiGainUpdate(&motor_hfi);
+}
+
+/*
+ *	PI零点抵消电气极点 R/L,开环为 wc/s*exp(-s*Td),Td = CURRENT_LOOP_DELAY*Ts
+ *	延时不改幅值只吃相角,相角裕度 90deg - wc*Td,穿越频率按CURRENT_LOOP_PM_MIN限幅
+ *	20kHz时上限约1.67kHz;Kp = L*wc  Ki = R*wc*Ts
+ */
+void CurrentLoopGainUpdate(void)
+{
+	float td = CURRENT_LOOP_DELAY * motor.pwm_Ts;
+	float wc = 2*PI*motor_foc.Bandwidth;
+	float wcMax = (90.0f - CURRENT_LOOP_PM_MIN) * (PI/180) / td;
+
+	if(wc > wcMax)
+		wc = wcMax;
+	motor_foc.pi_d.Kp = motor.Motor_Ld_pu * wc;
+	motor_foc.pi_d.Ki = motor.Motor_Rs_pu * wc * motor.pwm_Ts;
+	motor_foc.pi_d.Kc = motor_foc.pi_d.Ki / motor_foc.pi_d.Kp;
+	motor_foc.pi_q.Kp = motor.Motor_Lq_pu * wc;
+	motor_foc.pi_q.Ki = motor.Motor_Rs_pu * wc * motor.pwm_Ts;
+	motor_foc.pi_q.Kc = motor_foc.pi_q.Ki / motor_foc.pi_q.Kp;
+}
+
+/*
+ *	任务调用,带宽限幅在[CURRENT_LOOP_BW_MIN_HZ,CURRENT_LOOP_BW_MAX_HZ],返回实际值
+ *	只改PI增益,不动观测器,运行中可以调
+ */
+float CurrentLoopSetBandwidth(float hz)
+{
+	Constrain(hz,CURRENT_LOOP_BW_MIN_HZ,CURRENT_LOOP_BW_MAX_HZ);
+	motor_foc.Bandwidth = hz;
+	CurrentLoopGainUpdate();
+	return hz;
+}
+
+/*
+ *	母线电压决定svpwm的Q15满量程(Vbus/sqrt(3))和电压圆限幅
+ *	电池掉压时同样的Q15输出对应更小的电压,这里跟着改归一化系数
+ */
+FAST_CODE void CurrentBusVoltageUpdate(void)
+{
+	float vbus = motor_fbk.Vbus;
+
+	if(vbus < VBUS_MIN)
+		vbus = VBUS_MIN;
+	motor_foc.VoltToQ15 = VALUE_Q15 * 1.7321f / vbus;
+	motor_foc.Umax = vbus * (CURRENT_LOOP_U_RATIO / 1.7321f);
+	motor_fbk.Vbus_Q15 = motor_fbk.Vbus * (VALUE_Q15 / SMO_U_BASE);
+}
+
+void CurrentLoopReset(void)
+{
+	motor_foc.pi_d.Ui = 0;
+	motor_foc.pi_d.Out = 0;
+	motor_foc.pi_q.Ui = 0;
+	motor_foc.pi_q.Out = 0;
+	motor_foc.pi_d.Ff = 0;
+	motor_foc.pi_q.Ff = 0;
+	motor_foc.Ud_out = 0;
+	motor_foc.Uq_out = 0;
+	motor_foc.Ualpha_out = 0;
+	motor_foc.Ubeta_out = 0;
+	motor_foc.fw.Id = 0;
+	motor_motion.Active = false;
+}
+
+/*
+ *	输出限幅在[-OutMax,OutMax],饱和部分按Kc反算回积分器
+ *	Ff算在限幅以内,前馈占掉的余量积分器不会再积
+ */
+FAST_CODE float PIRegulatorRun(PIRegulator *pi,float err)
+{
+	float presat = pi->Kp * err + pi->Ui + pi->Ff;
+	pi->Out = presat;
+	Constrain(pi->Out,-pi->OutMax,pi->OutMax);
+	pi->Ui += pi->Ki * err + pi->Kc * (pi->Out - presat);
+	return pi->Out;
+}
+
+/*
+ *	用上一周期的输出电压,电压圆限幅后|Udq|<=Umax,饱和时误差为负
+ */
+FAST_CODE static void FieldWeakeningRun(FieldWeakening *fw,float ud,float uq,float umax)
+{
+	if(!fw->Enable)
+	{
+		fw->Id = 0;
+		return;
+	}
+	fw->Id += fw->Ki * (fw->Ratio * umax - sqrtf(ud*ud + uq*uq));
+	Constrain(fw->Id,fw->IdMin,0);
 }
 
+/*
+ *	零偏按相累计,三电阻时每周期轮换不采样的相,三相都能标定
+ */
 void adc_zero(void)
 {
-	static uint32_t mot_a_sum=0,mot_b_sum=0,cnt=0;
+	static uint32_t mot_sum[MotorPhase_Num],mot_num[MotorPhase_Num],cnt=0;
+	uint16_t ad[MotorPhase_Num] = {adc_result.adc_currnt_a,adc_result.adc_current_b,adc_result.adc_current_c};
 	if(cnt >= 100)//wait for system health
 	{
-		mot_a_sum += adc_result.adc_currnt_a;
-		mot_b_sum += adc_result.adc_current_b;
+		for(uint8_t j = 0;j<MotorPhase_Num;j++)
+		{
+			if(j == adc_result.shunt_skip)
+				continue;
+			mot_sum[j] += ad[j];
+			mot_num[j]++;
+		}
 	}
 	cnt++;
 	if(cnt >= 356)
 	{
-		adc_result.motor_a_zero = mot_a_sum/256;
-		adc_result.motor_b_zero = mot_b_sum/256;
+		adc_result.motor_a_zero = mot_sum[MotorPhase1]/mot_num[MotorPhase1];
+		adc_result.motor_b_zero = mot_sum[MotorPhase2]/mot_num[MotorPhase2];
+		adc_result.motor_c_zero = mot_num[MotorPhase3] ? mot_sum[MotorPhase3]/mot_num[MotorPhase3] : 2048;
 		adc_result.haszero = true;
 	}
+#if CURRENT_THREE_SHUNT
+	adc_result.shunt_next = (adc_result.shunt_skip + 1) % MotorPhase_Num;
+#endif
 }
 
-void motor_estimat_theta(void)
+/*
+ *	去零偏,三电阻时由另外两相重构没采样的那一相
+ */
+FAST_CODE static void CurrentReconstruct(void)
+{
+	int32_t ia = (int32_t)adc_result.adc_currnt_a - adc_result.motor_a_zero;
+	int32_t ib = (int32_t)adc_result.adc_current_b - adc_result.motor_b_zero;
+#if CURRENT_THREE_SHUNT
+	int32_t ic = (int32_t)adc_result.adc_current_c - adc_result.motor_c_zero;
+
+	switch(adc_result.shunt_skip)
+	{
+		case MotorPhase1:	ia = -ib - ic;	break;
+		case MotorPhase2:	ib = -ia - ic;	break;
+		default:break;
+	}
+#endif
+	adc_result.ia_ad = ia;
+	adc_result.ib_ad = ib;
+}
+
+FAST_CODE void motor_estimat_theta(void)
 {
 	float I_error_abs;
 	motor_Estimate.Ialpha_estimate_pu = (motor_Estimate.Gctrl*(motor_Estimate.Ualpha_pll_compens - motor_Estimate.Ealpha_estimate_pu - motor_Estimate.Adjust_alpha_pu) + motor_Estimate.Fctrl * motor_Estimate.Ialpha_estimate_pu);
@@ -78,59 +265,321 @@ void motor_estimat_theta(void)
 	motor_Estimate.Ealpha_estimate_pu_filt += motor_Estimate.Klsf * (motor_Estimate.Ealpha_estimate_pu - motor_Estimate.Ealpha_estimate_pu_filt);
 	motor_Estimate.Ebeta_estimate_pu_filt += motor_Estimate.Klsf * (motor_Estimate.Ebeta_estimate_pu - motor_Estimate.Ebeta_estimate_pu_filt);
 
-	motor_Estimate.Theta_estimate = atan2f(motor_Estimate.Ebeta_estimate_pu_filt,-motor_Estimate.Ealpha_estimate_pu_filt);
+#if SMO_ANGLE_PLL
+	motor_estimat_pll();
+#else
+	motor_Estimate.Theta_estimate = Atan2Fast(-motor_Estimate.Ealpha_estimate_pu_filt,motor_Estimate.Ebeta_estimate_pu_filt);
+#endif
+}
+
+/*
+ *	反电动势锁相环,与SmoQ15PllUpdate相同的鉴相器
+ *	q = -Ealpha*cos - Ebeta*sin = |E|*sin(theta - theta_pll)
+ */
+FAST_CODE void motor_estimat_pll(void)
+{
+	float s,c,q,d,mag;
+	Q15 sinQ15,cosQ15;
+
+	SinCosQ15((int32_t)(motor_Estimate.Theta_estimate * (VALUE_Q12 / (2*PI))),&sinQ15,&cosQ15);
+	s = sinQ15 * (1.0f/VALUE_Q15);
+	c = cosQ15 * (1.0f/VALUE_Q15);
+	q = -motor_Estimate.Ealpha_estimate_pu_filt * c - motor_Estimate.Ebeta_estimate_pu_filt * s;
+	d = motor_Estimate.Ebeta_estimate_pu_filt * c - motor_Estimate.Ealpha_estimate_pu_filt * s;
+	mag = sqrtf(q*q + d*d);
+	if(mag < SMO_PLL_E_MIN)
+		mag = SMO_PLL_E_MIN;
+	motor_Estimate.Pll_err = q / mag;
+	if(motor_Estimate.Omega_estimate < 0)
+		motor_Estimate.Pll_err = -motor_Estimate.Pll_err;
+
+	motor_Estimate.Omega_estimate += motor_Estimate.Pll_Ki * motor_Estimate.Pll_err;
+	motor_Estimate.Theta_estimate += (motor_Estimate.Omega_estimate + motor_Estimate.Pll_Kp * motor_Estimate.Pll_err) * motor.pwm_Ts;
+	if(motor_Estimate.Theta_estimate > PI)
+		motor_Estimate.Theta_estimate -= 2*PI;
+	else if(motor_Estimate.Theta_estimate <= -PI)
+		motor_Estimate.Theta_estimate += 2*PI;
 }
 
-volatile uint64_t micro_start,micro_diff,micro_now;
-uint64_t rotate=0;
-void CurrentRunning(uint32_t focId,uint16_t *sample)
+/*
+ *	定点观测器,输入直接取ADC码值和PWM脉宽,不经过浮点
+ *	凸极电机按扩展反电动势,电压先减去 w*(Ld-Lq)*(ibeta,-ialpha),估出的反电动势落在q轴上
+ *	结果同步到motor_Estimate供遥测使用
+ */
+FAST_CODE void motor_estimat_theta_q15(void)
+{
+	Q15 ialpha = adc_result.ia_ad * (VALUE_Q15/2048);
+	Q15 ibeta = ((ialpha + 2*(adc_result.ib_ad * (VALUE_Q15/2048))) * INV_SQRT3_Q15) >> 15;
+	Q15 ualpha = motor_Estimate.Uan_Q15;
+	Q15 ubeta = ((motor_Estimate.Uan_Q15 + 2*motor_Estimate.Ubn_Q15) * INV_SQRT3_Q15) >> 15;
+	float k = motor_Estimate.Omega_estimate * motor_Estimate.Ldq * (SMO_I_BASE/SMO_U_BASE);
+
+	ualpha -= (Q15)(k * ibeta);
+	ubeta += (Q15)(k * ialpha);
+	SmoQ15Update(&motor_smo,ialpha,ibeta,ualpha,ubeta);
+
+	motor_Estimate.Ealpha_estimate_pu_filt = motor_smo.Ealpha_estimate_filt * (SMO_U_BASE/VALUE_Q24);
+	motor_Estimate.Ebeta_estimate_pu_filt = motor_smo.Ebeta_estimate_filt * (SMO_U_BASE/VALUE_Q24);
+	motor_Estimate.Theta_estimate = (int16_t)(motor_smo.Theta << 4) * (PI/VALUE_Q15);
+	motor_Estimate.Omega_estimate = motor_smo.PllOmega * (PWM_FREQUENCE_VAL*2*PI/4294967296.0f);
+}
+
+/*
+ *	线性kctrl的电流误差环和两级Klsf低通都让估出的反电动势滞后
+ *	lag = atan(w*Ti) + 2*atan(w*Tf),按观测器转速补回
+ */
+FAST_CODE static void CurrentObserverLag(void)
+{
+	float w = motor_Estimate.Omega_estimate;
+	float theta = motor_Estimate.Theta_estimate + Atan2Fast(w * motor_Estimate.Lag_Ti,1) + 2*Atan2Fast(w * motor_Estimate.Lag_Tf,1);
+
+	if(theta > PI)
+		theta -= 2*PI;
+	else if(theta <= -PI)
+		theta += 2*PI;
+	motor_Estimate.Theta_comp = theta;
+}
+
+/*
+ *	开环拖动时用给定的角度增量,否则用观测器转速
+ *	Id/Iq取反馈值,与电机方程里的耦合项一致
+ */
+FAST_CODE static void CurrentLoopDecouple(void)
+{
+	float w;
+
+	if(!motor_foc.Decouple)
+	{
+		motor_foc.Omega = 0;
+		motor_foc.pi_d.Ff = 0;
+		motor_foc.pi_q.Ff = 0;
+		return;
+	}
+	if(motor_foc.ThetaSource == FocThetaSource_OpenLoop)
+		w = motor_foc.ThetaStep * (2*PI/SvpwmDriverRad) * motor.pwm_freq;
+	else if(motor_foc.ThetaSource == FocThetaSource_Startup)
+		w = motor_startup.Omega;
+	else if(motor_foc.ThetaSource == FocThetaSource_Hfi)
+		w = motor_hfi.Omega;
+	else
+		w = motor_Estimate.Omega_estimate;
+	motor_foc.Omega = w;
+	motor_foc.pi_d.Ff = -w * motor.Motor_Lq_pu * motor_foc.Iq_fbk;
+	motor_foc.pi_q.Ff = w * (motor.Motor_Ld_pu * motor_foc.Id_fbk + motor.Motor_Flux);
+}
+
+//补偿滞后后的观测器角度,0-4096
+FAST_CODE uint16_t CurrentLoopObserverTheta(void)
+{
+	return ((int32_t)(motor_Estimate.Theta_comp * (SvpwmDriverRad / (2*PI)) + SvpwmDriverRad)) & SvpwmDriverRad_mask;
+}
+
+FAST_CODE static void CurrentLoopTheta(void)
+{
+	Q15 sinQ15,cosQ15;
+
+	switch(motor_foc.ThetaSource)
+	{
+		case FocThetaSource_Observer:
+			motor_foc.Theta = CurrentLoopObserverTheta();
+			break;
+		case FocThetaSource_Hfi:
+			motor_foc.Theta = HfiUpdate(&motor_hfi,motor_fbk.Ialpha_fbk_pu,motor_fbk.Ibeta_fbk_pu);
+			break;
+		case FocThetaSource_External:
+		case FocThetaSource_Startup:
+			break;
+		case FocThetaSource_OpenLoop:
+		default:
+			motor_foc.Theta = (motor_foc.Theta + motor_foc.ThetaStep) & SvpwmDriverRad_mask;
+			break;
+	}
+	//与观测器锁相环共用一张sin表
+	SinCosQ15(motor_foc.Theta,&sinQ15,&cosQ15);
+	motor_foc.SinTheta = sinQ15 * (1.0f/VALUE_Q15);
+	motor_foc.CosTheta = cosQ15 * (1.0f/VALUE_Q15);
+}
+
+/*
+ *	Park -> 弱磁 -> 解耦前馈 -> d/q PI -> 反Park -> 高频注入 -> svpwm2
+ *	d轴优先:Iq给定限制在电流圆剩余部分,q轴输出限制在剩余的电压圆内
+ *	注入时电流环用去掉注入分量的基波,电压圆让出注入幅值
+ */
+FAST_CODE static void CurrentLoopRunning(void)
+{
+	float Uq_max,Iq_max,id_ref,iq_ref,umax;
+	float ialpha = motor_fbk.Ialpha_fbk_pu,ibeta = motor_fbk.Ibeta_fbk_pu;
+	bool hfi;
+
+	CurrentLoopTheta();
+	hfi = motor_foc.ThetaSource == FocThetaSource_Hfi;
+	umax = motor_foc.Umax;
+	if(hfi)
+	{
+		ialpha = motor_hfi.Ialpha;
+		ibeta = motor_hfi.Ibeta;
+		if(motor_hfi.Inject)
+			umax -= motor_hfi.Uh;
+	}
+
+	motor_foc.Id_fbk = ialpha * motor_foc.CosTheta + ibeta * motor_foc.SinTheta;
+	motor_foc.Iq_fbk = ibeta * motor_foc.CosTheta - ialpha * motor_foc.SinTheta;
+
+	//开环拖动时Id就是拖动电流,不弱磁
+	if(motor_foc.ThetaSource == FocThetaSource_OpenLoop || motor_foc.ThetaSource == FocThetaSource_Startup)
+		motor_foc.fw.Id = 0;
+	else
+		FieldWeakeningRun(&motor_foc.fw,motor_foc.Ud_out,motor_foc.Uq_out,motor_foc.Umax);
+	id_ref = motor_foc.Id_ref + motor_foc.fw.Id;
+	Constrain(id_ref,-motor_foc.Imax,motor_foc.Imax);
+	Iq_max = motor_foc.Imax * motor_foc.Imax - id_ref * id_ref;
+	Iq_max = Iq_max > 0 ? sqrtf(Iq_max) : 0;
+	iq_ref = motor_foc.Iq_ref;
+	Constrain(iq_ref,-Iq_max,Iq_max);
+	CurrentLoopDecouple();
+
+	motor_foc.pi_d.OutMax = umax;
+	motor_foc.Ud_out = PIRegulatorRun(&motor_foc.pi_d,id_ref - motor_foc.Id_fbk);
+
+	Uq_max = umax * umax - motor_foc.Ud_out * motor_foc.Ud_out;
+	motor_foc.pi_q.OutMax = Uq_max > 0 ? sqrtf(Uq_max) : 0;
+	motor_foc.Uq_out = PIRegulatorRun(&motor_foc.pi_q,iq_ref - motor_foc.Iq_fbk);
+
+	motor_foc.Ualpha_out = motor_foc.Ud_out * motor_foc.CosTheta - motor_foc.Uq_out * motor_foc.SinTheta;
+	motor_foc.Ubeta_out = motor_foc.Ud_out * motor_foc.SinTheta + motor_foc.Uq_out * motor_foc.CosTheta;
+	if(hfi)
+		HfiInject(&motor_hfi,&motor_foc.Ualpha_out,&motor_foc.Ubeta_out);
+
+	svpwmDri.outPutAlphaBeta(svpwmID,(int32_t)(motor_foc.Ualpha_out * motor_foc.VoltToQ15),(int32_t)(motor_foc.Ubeta_out * motor_foc.VoltToQ15));
+}
+
+/*
+ * svpwm的输出钩子:死区补偿后交给定时器锁存,再按实际CCR选下周期的采样相、重构相电压
+ * 通道有效时桥臂为低,桥臂电压 = Vbus*(Period-CCR)/Period,共模在Uan/Ubn里消掉
+ */
+FAST_CODE void CurrentLoopPulseUpdate(uint32_t svpwm_tim_id,uint16_t *pulse)
+{
+	uint16_t period = MotorSvpwmTimPeriod(svpwm_tim_id);
+
+	ISR_PROFILE_MARK(IsrStage_Modulation);
+	DeadTimeCompApply(&motor_dtc,pulse,period);
+	MotorSvpwmTimPulseUpdate(svpwm_tim_id,pulse);
+#if CURRENT_THREE_SHUNT
+	{
+		//通道有效时下桥导通,CCR最小的相下桥窗口最短,下个周期不采它
+		uint8_t skip = MotorPhase1;
+		for(uint8_t j = 1;j<MotorPhase_Num;j++)
+		{
+			if(pulse[j] < pulse[skip])
+				skip = j;
+		}
+		adc_result.shunt_next = skip;
+	}
+#endif
+	ISR_PROFILE_MARK(IsrStage_Ccr);
+	//死区损失的电压同样扣掉,等效脉宽 = CCR + Loss
+	{
+		int32_t pa = (int32_t)pulse[0] + motor_dtc.Loss[0];
+		int32_t pb = (int32_t)pulse[1] + motor_dtc.Loss[1];
+		int32_t pc = (int32_t)pulse[2] + motor_dtc.Loss[2];
+#if SMO_FIXED_POINT
+		//Q15,基值SMO_U_BASE
+		int32_t div = 3*(int32_t)period;
+
+		motor_Estimate.Uan_Q15 = (pb + pc - 2*pa) * motor_fbk.Vbus_Q15 / div;
+		motor_Estimate.Ubn_Q15 = (pa + pc - 2*pb) * motor_fbk.Vbus_Q15 / div;
+#else
+		float k = motor_fbk.Vbus / period;
+
+		motor_Estimate.Ua_pu = ((int32_t)period - pa)*k;
+		motor_Estimate.Ub_pu = ((int32_t)period - pb)*k;
+		motor_Estimate.Uc_pu = ((int32_t)period - pc)*k;
+
+		motor_Estimate.Uan_pu = (motor_Estimate.Ua_pu * 2 - motor_Estimate.Ub_pu - motor_Estimate.Uc_pu)/3.0f;
+		motor_Estimate.Ubn_pu = (motor_Estimate.Ub_pu * 2 - motor_Estimate.Ua_pu - motor_Estimate.Uc_pu)/3.0f;
+#endif
+	}
+}
+
+static uint8_t plotDecimate FAST_DATA;
+FAST_CODE void CurrentRunning(uint32_t focId,uint16_t *sample)
 {
-	static uint8_t state;
 #if 0
 	SerialPlotFrameInput(sample);
 #endif
-	adc_result.adc_currnt_a = sample[0];
-	adc_result.adc_current_b = sample[1];
+	ISR_PROFILE_MARK(IsrStage_Dma);
+	if(sample[ADC_SAMPLE_VBUS] != ADC_VBUS_NONE)
+	{
+		adc_result.adc_vbus = sample[ADC_SAMPLE_VBUS];
+		motor_fbk.Vbus += motor_fbk.Vbus_k * (adc_result.adc_vbus * VBUS_ADC_FACTOR - motor_fbk.Vbus);
+		CurrentBusVoltageUpdate();
+	}
+	adc_result.adc_currnt_a = sample[MotorPhase1];
+	adc_result.adc_current_b = sample[MotorPhase2];
+#if CURRENT_THREE_SHUNT
+	adc_result.adc_current_c = sample[MotorPhase3];
+	if(sample[MotorPhase1] == ADC_SHUNT_SKIPPED)
+		adc_result.shunt_skip = MotorPhase1;
+	else if(sample[MotorPhase2] == ADC_SHUNT_SKIPPED)
+		adc_result.shunt_skip = MotorPhase2;
+	else
+		adc_result.shunt_skip = MotorPhase3;
+#endif
 	if(!adc_result.haszero)
 	{
 		adc_zero();
 		return;
 	}
 
-	motor_fbk.Ia_fbk_ad = adc_result.adc_currnt_a - adc_result.motor_a_zero;
-	motor_fbk.Ib_fbk_ad = adc_result.adc_current_b - adc_result.motor_b_zero;
+	CurrentReconstruct();
+	motor_fbk.Ia_fbk_ad = adc_result.ia_ad;
+	motor_fbk.Ib_fbk_ad = adc_result.ib_ad;
 
 	motor_fbk.Ia_fbk_real = motor_fbk.Ia_fbk_ad * motor_fbk.I_fbk_factor;
 	motor_fbk.Ib_fbk_real = motor_fbk.Ib_fbk_ad * motor_fbk.I_fbk_factor;
 
 	motor_fbk.Ialpha_fbk_pu = motor_fbk.Ia_fbk_real;
 	motor_fbk.Ibeta_fbk_pu = (2*motor_fbk.Ib_fbk_real + motor_fbk.Ia_fbk_real) / 1.7321f;
+	DeadTimeCompUpdate(&motor_dtc,motor_fbk.Ia_fbk_real,motor_fbk.Ib_fbk_real,motor_fbk.Vbus);
+	ISR_PROFILE_MARK(IsrStage_Sample);
 
-	motor_Estimate.Ualpha_pll_compens = motor_Estimate.Uan_pu;
-	motor_Estimate.Ubeta_pll_compens = (2*motor_Estimate.Uan_pu + motor_Estimate.Ubn_pu) / 1.7321f;
+#if SMO_FIXED_POINT
+	motor_estimat_theta_q15();
+#else
+	motor_Estimate.Ualpha_pll_compens = motor_Estimate.Uan_pu - motor_Estimate.Omega_estimate * motor_Estimate.Ldq * motor_fbk.Ibeta_fbk_pu;
+	motor_Estimate.Ubeta_pll_compens = (2*motor_Estimate.Ubn_pu + motor_Estimate.Uan_pu) / 1.7321f + motor_Estimate.Omega_estimate * motor_Estimate.Ldq * motor_fbk.Ialpha_fbk_pu;
 
 	motor_estimat_theta();
+#endif
+	CurrentObserverLag();
+	ISR_PROFILE_MARK(IsrStage_Observer);
 
+	//任务用setUse占用了驱动(编码器标定等开环输出)时电流环不写PWM
+	//参数辨识的注入阶段自己输出电压,转动阶段借用电流环
+	if(svpwmDri.claimUse(svpwmID,0))
+	{
+		CurrentLoopReset();
+		//没有写PWM,补上这两段的时间戳
+		ISR_PROFILE_MARK(IsrStage_Modulation);
+		ISR_PROFILE_MARK(IsrStage_Ccr);
+	}else if(!MotorIdentRun(&motor_ident))
+	{
+		MotorStartupRun(&motor_startup);
+		if(motor_foc.Enable)
+		{
+			CurrentLoopRunning();
+			MotionRun(&motor_motion);
+		}else
+		{
+			CurrentLoopReset();
+			svpwmDri.outPutAlphaBeta(svpwmID,0,0);
+		}
+	}
 
-	#if 1
-	micro_now = GetMicro();
-	if(micro_now - micro_start > 100)
+	if(++plotDecimate >= CURRENT_PLOT_DECIMATE)
 	{
-		micro_start = micro_now;
-//		frame.fdata[0] = motor_Estimate.Ealpha_estimate_pu_filt;
-//		frame.fdata[0] = motor_Estimate.Theta_estimate*57.3f;
-//		frame.fdata[0] = motor_Estimate.Ialpha_estimate_pu;
-		frame.fdata[0] = motor_fbk.Ialpha_fbk_pu;
-		frame.fdata[1] = motor_fbk.Ibeta_fbk_pu;
-//		frame.fdata[1] = motor_Estimate.Ialpha_pu_err;
-//		frame.fdata[1] = motor_Estimate.Ebeta_estimate_pu_filt;
-	PIOS_COM_SendBufferNonBlocking(comDebugId, (uint8_t*)&frame, (uint16_t)sizeof(frame));
+		plotDecimate = 0;
+		SerialPlotRingPush(motor_foc.Id_fbk,motor_foc.Iq_fbk);
 	}
-	#endif
-	svpwmDri.outPut(svpwmID,0.35,0,rotate,false);
-	rotate+=5;
+	ISR_PROFILE_END();
 }
-
-
-
-
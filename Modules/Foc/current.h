@@ -1,12 +1,21 @@
+#ifndef __CURRENT_H_
+#define __CURRENT_H_
+
 #include "string.h"
 #include "stdio.h"
 #include "stdbool.h"
+#include "stdint.h"
 
 #define PI	3.1415926f
 
+#include "smo.h"
+#include "deadtime.h"
+#include "motorident.h"
+
 #define MOTOR_RS			4.2f
 #define MOTOR_LD			0.0025f
 #define MOTOR_LQ			0.0025f
+#define MOTOR_FLUX			0.006f						//永磁体磁链 Wb,可由motorident辨识
 #define MOTOR_POLES_VAL		11
 #define BASE_RPM_CNTRL_VAL	9500
 #define VDC_BUS 			12.0f						//12V的直流电压
@@ -22,12 +31,57 @@
 
 #define PWM_FREQUENCE_VAL	20000
 
+#ifndef SMO_FIXED_POINT
+#define SMO_FIXED_POINT		1							//1:定点观测器(smo.c) 0:浮点观测器(motor_estimat_theta)
+#endif
+#define SMO_U_BASE			VDC_BUS						//定点观测器电压基值
+#define SMO_I_BASE			(2048*0.000805664f)			//定点观测器电流基值,ADC满量程
+#define SMO_PLL_BW_HZ		50.0f						//反电动势锁相环自然频率
+#define SMO_PLL_E_MIN		0.00001f					//锁相环归一化的反电动势下限 V
+
+#define CURRENT_LOOP_BW_HZ	800.0f						//电流环默认带宽(开环穿越频率),协议可改
+#define CURRENT_LOOP_BW_MIN_HZ	50.0f
+#define CURRENT_LOOP_BW_MAX_HZ	(PWM_FREQUENCE_VAL/10.0f)
+#define CURRENT_LOOP_DELAY	1.5f						//采样到电压生效的延时,PWM周期:计算1周期+零阶保持半周期
+#define CURRENT_LOOP_PM_MIN	45.0f						//延时下的最小相角裕度 deg,开环穿越频率按它限幅
+#define CURRENT_LOOP_U_RATIO	0.95f						//电压矢量圆限幅,相对Vbus/sqrt(3)
+#define CURRENT_LOOP_I_MAX	1.5f						//电流矢量圆限幅 A,弱磁的Id优先
+#define CURRENT_DECOUPLE	1							//1:默认开解耦前馈 -w*Lq*Iq, w*(Ld*Id+flux),协议可开关
+#define FW_U_RATIO			0.9f						//弱磁:电压幅值超过Umax的该比例后注入负Id
+#define FW_KI				0.001f						//弱磁积分增益 A/V,每周期
+#define FW_ID_MIN			(-0.5f)						//最大弱磁电流 A,Rs大,超过约-psi*w^2*L/(Rs^2+w^2*L^2)后|Udq|反而变大
+#define OPENLOOP_ID_REF		0.4f						//开环拖动时的d轴电流
+#define OPENLOOP_THETA_STEP	5							//开环拖动每个中断的角度增量 0-4096
+#define CURRENT_PLOT_DECIMATE	5						//每N个PWM周期向SerialPlotTask推一帧,4kHz*10字节=40kB/s,不到921600波特率的一半,余量给协议帧和printf
+
+#ifndef CURRENT_THREE_SHUNT
+#define CURRENT_THREE_SHUNT	0							//1:三电阻采样,每周期采下桥窗口最宽的两相,第三相由Ia+Ib+Ic=0重构
+#endif
+#define ADC_SHUNT_SKIPPED	0xFFFF						//本周期未采样的相,sample[]里的占位值
+
+#define ADC_SAMPLE_VBUS		3							//sample[]里母线电压的位置,在三相之后
+#define ADC_SAMPLE_NUM		4
+#define ADC_VBUS_NONE		0xFFFF						//本周期没有母线电压,沿用滤波值
+#define VBUS_ADC_FACTOR		(3.3f/4096*11)				//母线分压10k:1k,V/LSB
+#define VBUS_FILTER_HZ		200.0f						//母线电压一阶低通截止频率
+#define VBUS_MIN			6.0f						//归一化用的母线电压下限
+
 typedef struct{
 	uint16_t adc_currnt_a;
 	uint16_t adc_current_b;
+	uint16_t adc_current_c;
+	uint16_t adc_vbus;
 
 	uint16_t motor_a_zero;
 	uint16_t motor_b_zero;
+	uint16_t motor_c_zero;
+
+	//去零偏后的码值,未采样的一相已重构
+	int16_t	ia_ad;
+	int16_t	ib_ad;
+
+	uint8_t	shunt_skip;		//本次未采样的相
+	uint8_t	shunt_next;		//下次触发不采样的相,由ADC中断写进SQR3
 
 	bool	haszero;
 
@@ -42,6 +96,10 @@ typedef struct{
 
 	float Ialpha_fbk_pu;
 	float Ibeta_fbk_pu;
+
+	float Vbus;				//滤波后的母线电压 V
+	float Vbus_k;			//母线低通系数
+	Q15	Vbus_Q15;			//Vbus/SMO_U_BASE,电池满电时可大于1
 }sysFbkVals;
 
 typedef struct{
@@ -73,9 +131,21 @@ typedef struct{
 	float Klsf;//低通滤波器系数
 
 	float Theta_estimate;
+	float Omega_estimate;//电角速度 rad/s
+	float Theta_comp;//补上观测器滞后的角度,电流环/启动/HFI用
+	float Lag_Ti;//电流误差环时间常数 L/(R+kctrl)-Ts
+	float Lag_Tf;//Klsf低通时间常数
+	float Ldq;//Ld-Lq,扩展反电动势模型的交叉项
+
+	//反电动势锁相环
+	float Pll_Kp;
+	float Pll_Ki;//Ki*Ts
+	float Pll_err;
 
 	float Uan_pu;
 	float Ubn_pu;
+	Q15	Uan_Q15;
+	Q15	Ubn_Q15;
 
 	float Ua_pu;
 	float Ub_pu;
@@ -86,19 +156,93 @@ typedef struct{
 	float Motor_Rs_pu;
 	float Motor_Ld_pu;
 	float Motor_Lq_pu;
+	float Motor_Flux;
 
 	float pwm_freq;
 	float pwm_Ts;
 }MotorParamVars;
 
+enum{
+	FocThetaSource_OpenLoop = 0,
+	FocThetaSource_Observer,
+	FocThetaSource_External,		//motor_foc.Theta由外部(编码器)写入
+	FocThetaSource_Startup,			//无感启动的对齐/拖动/切换,motor_foc.Theta由MotorStartupRun写入
+	FocThetaSource_Hfi,				//低速高频注入跟踪,按转速过渡到观测器
+};
+
+typedef struct{
+	float Kp;
+	float Ki;			//Ki*Ts
+	float Kc;			//积分抗饱和反算系数
+	float Ui;
+	float Ff;			//前馈,在限幅之前加上,饱和时积分器同样反算
+	float OutMax;
+	float Out;
+}PIRegulator;
+
+/*
+ *	电压幅值反馈弱磁:|Udq|超过Ratio*Umax时积分出负Id,低于时退回0
+ */
+typedef struct{
+	bool	Enable;
+	float	Ratio;
+	float	Ki;				//Ki*Ts A/V
+	float	IdMin;
+	float	Id;				//注入的d轴电流
+}FieldWeakening;
+
+typedef struct{
+	bool	Enable;
+	uint8_t	ThetaSource;
+
+	uint16_t Theta;		//0-4096	0-2*pi
+	uint16_t ThetaStep;
+	float	SinTheta;
+	float	CosTheta;
+
+	float	Id_ref;
+	float	Iq_ref;
+	float	Id_fbk;
+	float	Iq_fbk;
+
+	PIRegulator	pi_d;
+	PIRegulator	pi_q;
+	FieldWeakening	fw;
+	bool	Decouple;			//交叉耦合和反电动势前馈
+	float	Omega;				//前馈用的电角速度 rad/s
+	float	Imax;
+	float	Bandwidth;			//电流环带宽 Hz,改后由CurrentLoopGainUpdate重算PI
+
+	float	Ud_out;
+	float	Uq_out;
+	float	Ualpha_out;
+	float	Ubeta_out;
+	float	Umax;
+	float	VoltToQ15;
+}sysFocCtrlVals;
+
 extern adc_result_type adc_result;
 extern sysFbkVals motor_fbk;
 extern sysEstimateVals motor_Estimate;
+extern SmoQ15 motor_smo;
+extern DeadTimeComp motor_dtc;
+extern MotorIdent motor_ident;
 extern MotorParamVars motor;
+extern sysFocCtrlVals motor_foc;
 
 void MotorInit(void);
+void MotorParamUpdate(void);
 void adc_zero(void);
 void CurrentRunning(uint32_t focId,uint16_t *sample);
-
-
-
+void CurrentLoopPulseUpdate(uint32_t svpwm_tim_id,uint16_t *pulse);
+void motor_estimat_theta(void);
+void motor_estimat_pll(void);
+void motor_estimat_theta_q15(void);
+void CurrentLoopReset(void);
+uint16_t CurrentLoopObserverTheta(void);
+void CurrentLoopGainUpdate(void);
+float CurrentLoopSetBandwidth(float hz);
+float PIRegulatorRun(PIRegulator *pi,float err);
+void CurrentBusVoltageUpdate(void);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * deadtime.c
+ *
+ *  svpwm2脉宽的死区和管压降补偿
+ */
+#include "deadtime.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+void DeadTimeCompInit(DeadTimeComp *dtc,float tdNs,float vdrop,float iBand,float pwmHz)
+{
+	dtc->TdFrac = tdNs * 1e-9f * pwmHz;
+	dtc->Vdrop = vdrop;
+	dtc->InvIBand = 1.0f / iBand;
+	for(uint8_t j = 0;j<3;j++)
+	{
+		dtc->LossFrac[j] = 0;
+		dtc->Loss[j] = 0;
+	}
+	dtc->Enable = true;
+}
+
+/*
+ * 电流环里采样后调用,电流方向取本次采样
+ */
+FAST_CODE void DeadTimeCompUpdate(DeadTimeComp *dtc,float ia,float ib,float vbus)
+{
+	float i[3] = {ia,ib,-ia - ib};
+	float full = dtc->TdFrac + dtc->Vdrop / vbus;
+
+	for(uint8_t j = 0;j<3;j++)
+	{
+		float s = i[j] * dtc->InvIBand;
+		Constrain(s,-1.0f,1.0f);
+		dtc->LossFrac[j] = dtc->Enable ? full * s : 0;
+	}
+}
+
+/*
+ * 写CCR之前调用,pulse按svpwm2的约定:越小桥臂电压越高
+ */
+FAST_CODE void DeadTimeCompApply(DeadTimeComp *dtc,uint16_t *pulse,uint16_t period)
+{
+	for(uint8_t j = 0;j<3;j++)
+	{
+		float x = dtc->LossFrac[j] * period;
+		int32_t loss = (int32_t)(x >= 0 ? x + 0.5f : x - 0.5f);
+		int32_t p = (int32_t)pulse[j] - loss;
+
+		Constrain(p,0,(int32_t)period);
+		pulse[j] = p;
+		dtc->Loss[j] = loss;
+	}
+}
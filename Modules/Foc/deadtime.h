@@ -0,0 +1,30 @@
+/*
+ * deadtime.h
+ *
+ *  死区和管压降补偿,按电流方向修正svpwm2输出的脉宽
+ */
+
+#ifndef __DEADTIME_H_
+#define __DEADTIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DEADTIME_COMP_NS		300.0f		//死区+开关延时 ns,按驱动芯片实测改
+#define DEADTIME_COMP_VDROP		0.05f		//管压降 V
+#define DEADTIME_COMP_IBAND		0.05f		//过零区半宽 A,区内补偿量随电流线性过渡
+
+typedef struct{
+	bool	Enable;
+	float	TdFrac;				//Td*fpwm,死区占一个PWM周期的比例
+	float	Vdrop;
+	float	InvIBand;
+	float	LossFrac[3];		//各相损失的占空比,>0表示桥臂电压偏低
+	int16_t	Loss[3];			//同上,换算成本次写入的脉宽计数,电压重构用
+}DeadTimeComp;
+
+void DeadTimeCompInit(DeadTimeComp *dtc,float tdNs,float vdrop,float iBand,float pwmHz);
+void DeadTimeCompUpdate(DeadTimeComp *dtc,float ia,float ib,float vbus);
+void DeadTimeCompApply(DeadTimeComp *dtc,uint16_t *pulse,uint16_t period);
+
+#endif /* __DEADTIME_H_ */
@@ -0,0 +1,180 @@
+/*
+ * hfi.c
+ *
+ *  方波注入、解调、凸极跟踪及到观测器的过渡,每个电流环中断一步
+ */
+#include "hfi.h"
+#include <math.h>
+#include <string.h>
+#include "svpwm.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+/*
+ *	MotorParamUpdate之前调用,增益由MotorParamUpdate里的HfiGainUpdate算
+ */
+void HfiInit(Hfi *hfi)
+{
+	memset(hfi,0,sizeof(Hfi));
+	hfi->Uh = HFI_VOLTAGE;
+	hfi->Sign = 1;
+	hfi->Cos = 1;
+}
+
+/*
+ *	Ld/Lq或注入幅值改了之后重算,Ld==Lq时没有可跟踪的信号
+ */
+void HfiGainUpdate(Hfi *hfi)
+{
+	float wn = 2*PI*HFI_PLL_BW_HZ;
+	float dl = 1/motor.Motor_Ld_pu - 1/motor.Motor_Lq_pu;
+
+	hfi->Valid = fabsf(motor.Motor_Lq_pu - motor.Motor_Ld_pu) >= HFI_SALIENCY_MIN * motor.Motor_Ld_pu;
+	hfi->ErrK = hfi->Valid ? 1 / (hfi->Uh * motor.pwm_Ts * dl) : 0;
+	hfi->ErrLpK = 2*PI*HFI_DEMOD_LPF_HZ * motor.pwm_Ts;
+	hfi->Kp = 2*0.707f*wn;
+	hfi->Ki = wn*wn*motor.pwm_Ts;
+}
+
+//任务调用,限幅在[HFI_VOLTAGE_MIN,HFI_VOLTAGE_MAX],返回实际值
+float HfiSetVoltage(Hfi *hfi,float volt)
+{
+	Constrain(volt,HFI_VOLTAGE_MIN,HFI_VOLTAGE_MAX);
+	hfi->Uh = volt;
+	HfiGainUpdate(hfi);
+	return volt;
+}
+
+FAST_CODE static float HfiWrap(float theta)
+{
+	if(theta > PI)
+		theta -= 2*PI;
+	else if(theta <= -PI)
+		theta += 2*PI;
+	return theta;
+}
+
+FAST_CODE static void HfiDirection(Hfi *hfi)
+{
+	Q15 s,c;
+
+	SinCosQ15(((int32_t)(hfi->Theta * (SvpwmDriverRad / (2*PI)))) & SvpwmDriverRad_mask,&s,&c);
+	hfi->Sin = s * (1.0f/VALUE_Q15);
+	hfi->Cos = c * (1.0f/VALUE_Q15);
+}
+
+//从theta开始注入,头两次采样的增量历史不全,不解调
+FAST_CODE static void HfiSeed(Hfi *hfi,float theta,float omega)
+{
+	hfi->Theta = theta;
+	hfi->PllOmega = omega;
+	hfi->Err = 0;
+	hfi->Fill = 2;
+	hfi->Inject = true;
+	HfiDirection(hfi);
+}
+
+/*
+ *	任务调用,从motor_foc.Theta开始跟踪,极性由它定
+ *	观测器已在HFI_W_HIGH以上时直接用观测器
+ *	ThetaSource最后写,中断看到它之前状态已经准备好
+ */
+bool HfiStart(Hfi *hfi)
+{
+	if(!hfi->Valid)
+		return false;
+	hfi->Weight = 0;
+	hfi->Omega = 0;
+	if(fabsf(motor_Estimate.Omega_estimate) < HFI_W_HIGH)
+		HfiSeed(hfi,HfiWrap(motor_foc.Theta * (2*PI/SvpwmDriverRad)),0);
+	else
+		hfi->Inject = false;
+	motor_foc.ThetaSource = FocThetaSource_Hfi;
+	return true;
+}
+
+/*
+ *	增量差 (di[k]-di[k-1])/2 乘符号,投到注入方向的q轴
+ *	= Uh*Ts*(1/Ld-1/Lq)*sin(2*dtheta)/2,乘ErrK后小角度时约为dtheta
+ */
+FAST_CODE static void HfiDemodulate(Hfi *hfi,float ialpha,float ibeta)
+{
+	float da = ialpha - hfi->IalphaLast;
+	float db = ibeta - hfi->IbetaLast;
+	float e;
+
+	hfi->Ialpha = 0.5f * (ialpha + hfi->IalphaLast);
+	hfi->Ibeta = 0.5f * (ibeta + hfi->IbetaLast);
+	if(hfi->Fill == 0)
+	{
+		e = 0.5f * hfi->Sign * ((db - hfi->DbetaLast) * hfi->Cos - (da - hfi->DalphaLast) * hfi->Sin) * hfi->ErrK;
+		hfi->Err += hfi->ErrLpK * (e - hfi->Err);
+		hfi->PllOmega += hfi->Ki * hfi->Err;
+		hfi->Theta = HfiWrap(hfi->Theta + (hfi->PllOmega + hfi->Kp * hfi->Err) * motor.pwm_Ts);
+		HfiDirection(hfi);
+	}else
+		hfi->Fill--;
+	hfi->DalphaLast = da;
+	hfi->DbetaLast = db;
+}
+
+/*
+ *	每个PWM周期在CurrentLoopTheta里调用,ialpha/ibeta为本次采样
+ *	注入时Ialpha/Ibeta给出基波,返回跟踪角与观测器角按转速过渡后的角度 0-4096
+ *	参数改成没有凸极后不再重新注入,只用观测器
+ */
+FAST_CODE uint16_t HfiUpdate(Hfi *hfi,float ialpha,float ibeta)
+{
+	float thetaObs = motor_Estimate.Theta_comp;
+	float omegaObs = motor_Estimate.Omega_estimate;
+	float w,k,d;
+
+	if(hfi->Inject)
+	{
+		HfiDemodulate(hfi,ialpha,ibeta);
+	}else
+	{
+		hfi->Ialpha = ialpha;
+		hfi->Ibeta = ibeta;
+	}
+	hfi->IalphaLast = ialpha;
+	hfi->IbetaLast = ibeta;
+
+	w = fabsf(hfi->Inject ? hfi->PllOmega : omegaObs);
+	k = (w - HFI_W_LOW) / (HFI_W_HIGH - HFI_W_LOW);
+	Constrain(k,0,1);
+	if(hfi->Inject && (k >= 1 || !hfi->Valid))
+		hfi->Inject = false;
+	else if(!hfi->Inject && hfi->Valid && w < HFI_W_HIGH * HFI_W_HYST)
+		HfiSeed(hfi,thetaObs,omegaObs);
+	if(!hfi->Inject)
+	{
+		k = 1;
+		hfi->Theta = thetaObs;
+		hfi->PllOmega = omegaObs;
+	}
+
+	//过渡区里观测器可信,跟踪角若落在另一支上翻过来
+	d = HfiWrap(thetaObs - hfi->Theta);
+	if(k > 0 && fabsf(d) > PI/2)
+	{
+		hfi->Theta = HfiWrap(hfi->Theta + PI);
+		d = HfiWrap(d - PI);
+		HfiDirection(hfi);
+	}
+	hfi->Weight = k;
+	hfi->Omega = hfi->PllOmega + k * (omegaObs - hfi->PllOmega);
+	return ((int32_t)((hfi->Theta + k * d) * (SvpwmDriverRad / (2*PI)))) & SvpwmDriverRad_mask;
+}
+
+/*
+ *	电流环算完输出后调用,沿跟踪角的d轴叠加方波,每周期翻转
+ */
+FAST_CODE void HfiInject(Hfi *hfi,float *ualpha,float *ubeta)
+{
+	if(!hfi->Inject)
+		return;
+	hfi->Sign = -hfi->Sign;
+	*ualpha += hfi->Sign * hfi->Uh * hfi->Cos;
+	*ubeta += hfi->Sign * hfi->Uh * hfi->Sin;
+}
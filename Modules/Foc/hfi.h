@@ -0,0 +1,61 @@
+/*
+ * hfi.h
+ *
+ *  零低速高频方波注入,PWM/2方波,解调凸极误差跟踪角度,高速段过渡到观测器
+ */
+
+#ifndef __HFI_H_
+#define __HFI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "current.h"
+
+#define HFI_VOLTAGE				2.0f		//注入方波幅值 V,协议可改
+#define HFI_VOLTAGE_MIN			0.5f
+#define HFI_VOLTAGE_MAX			4.0f		//电流环输出限幅让出同样的电压
+#define HFI_SALIENCY_MIN		0.1f		//|Lq-Ld|/Ld下限
+#define HFI_DEMOD_LPF_HZ		1000.0f		//解调误差低通
+#define HFI_PLL_BW_HZ			50.0f		//跟踪环自然频率
+#define HFI_W_LOW				300.0f		//电角速度 rad/s,以上开始向观测器过渡
+#define HFI_W_HIGH				500.0f		//以上只用观测器,停止注入
+#define HFI_W_HYST				0.8f		//降到HFI_W_HIGH的该比例以下重新注入
+
+typedef struct{
+	bool	Valid;				//凸极足够,可以注入
+	bool	Inject;				//正在注入
+	int8_t	Sign;				//上一周期输出的注入符号,本次采样的增量由它产生
+	uint8_t	Fill;				//注入开始后增量历史未满的周期数
+	float	Uh;					//V
+
+	float	IalphaLast;			//上次采样
+	float	IbetaLast;
+	float	DalphaLast;			//上次的采样增量
+	float	DbetaLast;
+	float	Ialpha;				//基波,给电流环
+	float	Ibeta;
+
+	float	ErrK;				//1/(Uh*Ts*(1/Ld-1/Lq)),解调结果到角度误差
+	float	ErrLpK;
+	float	Err;				//rad
+	float	Kp;
+	float	Ki;					//Ki*Ts
+	float	Theta;				//跟踪角 rad,-pi~pi
+	float	PllOmega;			//跟踪环转速 rad/s
+	float	Sin;				//注入方向,即跟踪角
+	float	Cos;
+
+	float	Weight;				//观测器所占的权重 0-1
+	float	Omega;				//过渡后的电角速度 rad/s
+}Hfi;
+
+extern Hfi motor_hfi;
+
+void HfiInit(Hfi *hfi);
+void HfiGainUpdate(Hfi *hfi);
+float HfiSetVoltage(Hfi *hfi,float volt);
+bool HfiStart(Hfi *hfi);
+uint16_t HfiUpdate(Hfi *hfi,float ialpha,float ibeta);
+void HfiInject(Hfi *hfi,float *ualpha,float *ubeta);
+
+#endif /* __HFI_H_ */
@@ -0,0 +1,103 @@
+/*
+ * isrprofile.c
+ *
+ *  电流环中断DWT周期统计
+ */
+#include "isrprofile.h"
+#include <string.h>
+#include "driver_stm32.h"
+#include "fastmem.h"
+
+//单核上ISR完整抢占任务,只需阻止编译器重排
+#define ISR_PROFILE_BARRIER()	__asm volatile("" ::: "memory")
+
+IsrProfile isrProfile FAST_DATA;
+
+static void IsrProfileClear(void)
+{
+	for(uint8_t i = 0;i<IsrStage_Num;i++)
+	{
+		memset(&isrProfile.Stage[i],0,sizeof(IsrProfileStage));
+		isrProfile.Stage[i].Min = UINT32_MAX;
+	}
+	isrProfile.Overrun = 0;
+}
+
+void IsrProfileInit(uint32_t budgetCycles)
+{
+#if ISR_PROFILE_ENABLE
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	isrProfile.BudgetCycles = budgetCycles;
+	isrProfile.ResetRequest = false;
+	IsrProfileClear();
+}
+
+FAST_CODE static void IsrProfileAdd(IsrProfileStage *s,uint32_t cycles)
+{
+	uint32_t bin = 31 - __builtin_clz(cycles | 1);
+
+	if(bin >= ISR_PROFILE_HIST_BINS)
+		bin = ISR_PROFILE_HIST_BINS - 1;
+	s->Hist[bin]++;
+	s->Sum += cycles;
+	if(cycles < s->Min)
+		s->Min = cycles;
+	if(cycles > s->Max)
+		s->Max = cycles;
+	ISR_PROFILE_BARRIER();
+	s->Count++;
+}
+
+/*
+ * 中断末尾调用:由各阶段时间戳算出耗时并累计
+ * IsrStage_Total最后更新,它的Count兼作快照的序号
+ */
+FAST_CODE void IsrProfileEnd(void)
+{
+	uint32_t now = ISR_PROFILE_CYCCNT();
+	uint32_t last = isrProfile.Start;
+
+	if(isrProfile.ResetRequest)
+	{
+		IsrProfileClear();
+		isrProfile.ResetRequest = false;
+	}
+	for(uint8_t i = 0;i<IsrStage_Total;i++)
+	{
+		IsrProfileAdd(&isrProfile.Stage[i],isrProfile.Stamp[i] - last);
+		last = isrProfile.Stamp[i];
+	}
+	isrProfile.Stamp[IsrStage_Total] = now;
+	if(now - isrProfile.Start > isrProfile.BudgetCycles)
+		isrProfile.Overrun++;
+	IsrProfileAdd(&isrProfile.Stage[IsrStage_Total],now - isrProfile.Start);
+}
+
+//任务调用,下一次中断里清零
+void IsrProfileReset(void)
+{
+	isrProfile.ResetRequest = true;
+}
+
+/*
+ * 任务调用:复制一个阶段的统计,复制期间被中断更新则重试
+ * 返回false表示统计一直在变或该阶段还没有数据
+ */
+bool IsrProfileSnapshot(IsrStage stage,IsrProfileStage *out,uint32_t *overrun)
+{
+	DEBUG_Assert(stage < IsrStage_Num);
+	for(uint8_t retry = 0;retry<3;retry++)
+	{
+		uint32_t seq = isrProfile.Stage[IsrStage_Total].Count;
+		ISR_PROFILE_BARRIER();
+		*out = isrProfile.Stage[stage];
+		*overrun = isrProfile.Overrun;
+		ISR_PROFILE_BARRIER();
+		if(seq == isrProfile.Stage[IsrStage_Total].Count)
+			return out->Count != 0;
+	}
+	return false;
+}
@@ -0,0 +1,68 @@
+/*
+ * isrprofile.h
+ *
+ *  电流环中断分阶段的DWT周期统计:min/max/mean和log2直方图
+ */
+
+#ifndef __ISRPROFILE_H_
+#define __ISRPROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32f4xx_hal.h"
+
+#ifndef ISR_PROFILE_ENABLE
+#define ISR_PROFILE_ENABLE		1			//1:统计电流环中断各阶段周期数
+#endif
+
+#ifndef ISR_PROFILE_CYCCNT
+#define ISR_PROFILE_CYCCNT()	(DWT->CYCCNT)
+#endif
+
+#define ISR_PROFILE_HIST_BINS	16			//最后一格包含>=32768周期
+
+typedef enum{
+	IsrStage_Dma = 0,			//进中断到CurrentRunning,EOC/DMA标志处理和读结果
+	IsrStage_Sample,			//ADC码转Ialpha/Ibeta
+	IsrStage_Observer,			//观测器
+	IsrStage_Modulation,		//电流环PI,反Park,SVPWM
+	IsrStage_Ccr,				//写比较寄存器
+	IsrStage_Total,				//整个中断
+	IsrStage_Num,
+}IsrStage;
+
+typedef struct{
+	uint32_t Count;
+	uint32_t Min;
+	uint32_t Max;
+	uint64_t Sum;
+	uint32_t Hist[ISR_PROFILE_HIST_BINS];
+}IsrProfileStage;
+
+typedef struct{
+	uint32_t Start;
+	uint32_t Stamp[IsrStage_Num];			//各阶段结束时刻
+	IsrProfileStage Stage[IsrStage_Num];
+	uint32_t BudgetCycles;					//一个PWM周期的周期数
+	uint32_t Overrun;						//整个中断超过BudgetCycles的次数
+	volatile bool ResetRequest;
+}IsrProfile;
+
+extern IsrProfile isrProfile;
+
+#if ISR_PROFILE_ENABLE
+#define ISR_PROFILE_BEGIN()			(isrProfile.Start = ISR_PROFILE_CYCCNT())
+#define ISR_PROFILE_MARK(stage)		(isrProfile.Stamp[stage] = ISR_PROFILE_CYCCNT())
+#define ISR_PROFILE_END()			IsrProfileEnd()
+#else
+#define ISR_PROFILE_BEGIN()
+#define ISR_PROFILE_MARK(stage)
+#define ISR_PROFILE_END()
+#endif
+
+void IsrProfileInit(uint32_t budgetCycles);
+void IsrProfileEnd(void);
+void IsrProfileReset(void);
+bool IsrProfileSnapshot(IsrStage stage,IsrProfileStage *out,uint32_t *overrun);
+
+#endif /* __ISRPROFILE_H_ */
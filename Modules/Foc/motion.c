@@ -0,0 +1,279 @@
+/*
+ * motion.c
+ *
+ *  位置/速度环和S曲线轨迹,由CurrentRunning调用
+ */
+#include "motion.h"
+#include <math.h>
+#include <string.h>
+#include "svpwm.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+//任务写完给定再置请求标志,编译器不能把给定挪到标志之后
+#define MOTION_BARRIER()	__asm volatile("" ::: "memory")
+
+/*
+ *	MotorParamUpdate之前调用,增益由MotorParamUpdate里的MotionGainUpdate算
+ */
+void MotionInit(MotionCtrl *mc)
+{
+	memset(mc,0,sizeof(MotionCtrl));
+	mc->Mode = MotionMode_Off;
+	mc->PosDiv = MOTION_POS_DIV;
+	mc->VelDiv = MOTION_VEL_DIV;
+	mc->StepToRad = 2*PI / ((float)SvpwmDriverRad * MOTOR_POLES_VAL);
+}
+
+/*
+ *	Kt = 1.5*pole*flux,速度环 Kp = J*wv/Kt,PI零点在wv/4
+ *	改PosDiv/VelDiv或辨识出新磁链后重算
+ */
+void MotionGainUpdate(MotionCtrl *mc)
+{
+	float kt = 1.5f * MOTOR_POLES_VAL * motor.Motor_Flux;
+	float wv = 2*PI*MOTION_VEL_BW_HZ;
+	float tv = mc->VelDiv * motor.pwm_Ts;
+
+	mc->AccToIq = MOTION_INERTIA / kt;
+	mc->pi_vel.Kp = MOTION_INERTIA * wv / kt;
+	mc->pi_vel.Ki = mc->pi_vel.Kp * wv * 0.25f * tv;
+	mc->pi_vel.Kc = mc->pi_vel.Ki / mc->pi_vel.Kp;
+	mc->PosKp = 2*PI*MOTION_POS_BW_HZ;
+	mc->VelK = 2*PI*MOTION_VEL_FILTER_HZ * tv;
+	if(mc->VelK > 1)
+		mc->VelK = 1;
+}
+
+/*
+ *	以当前位置为原点,中断里在电流环重新运行时调用
+ *	模式和未处理的请求保留,位置模式下原地保持
+ */
+void MotionReset(MotionCtrl *mc)
+{
+	mc->ThetaLast = motor_foc.Theta;
+	mc->Steps = 0;
+	mc->StepsVel = 0;
+	mc->Pos = 0;
+	mc->Vel = 0;
+	mc->VelRef = 0;
+	mc->pi_vel.Ui = 0;
+	mc->pi_vel.Out = 0;
+	memset(&mc->traj,0,sizeof(MotionTraj));
+	mc->Active = true;
+}
+
+/*
+ *	任务调用,speed为机械角速度 rad/s,中断在下个周期切到速度模式
+ *	还没开始的位置请求作废
+ */
+void MotionSpeed(MotionCtrl *mc,float speed)
+{
+	mc->MovePending = false;
+	mc->SpeedCmd = speed;
+	MOTION_BARRIER();
+	mc->SpeedPending = true;
+}
+
+/*
+ *	任务调用,target为相对原点的机械角 rad
+ *	只投递请求,模式切换和轨迹都在中断里做
+ */
+void MotionMove(MotionCtrl *mc,float target)
+{
+	mc->MoveTarget = target;
+	MOTION_BARRIER();
+	mc->MovePending = true;
+}
+
+//任务调用,限幅在[1,MOTION_DIV_MAX],返回实际值
+uint8_t MotionSetPosDiv(MotionCtrl *mc,int32_t div)
+{
+	Constrain(div,1,MOTION_DIV_MAX);
+	mc->PosDiv = div;
+	MotionGainUpdate(mc);
+	return div;
+}
+
+uint8_t MotionSetVelDiv(MotionCtrl *mc,int32_t div)
+{
+	Constrain(div,1,MOTION_DIV_MAX);
+	mc->VelDiv = div;
+	MotionGainUpdate(mc);
+	return div;
+}
+
+/*
+ *	中断里处理任务投递的模式请求
+ *	切到位置模式时轨迹从当前位置起步
+ */
+FAST_CODE static void MotionRequest(MotionCtrl *mc)
+{
+	if(mc->SpeedPending)
+	{
+		mc->SpeedPending = false;
+		mc->Mode = MotionMode_Speed;
+	}
+	if(mc->MovePending && mc->Mode != MotionMode_Position)
+	{
+		mc->traj.Busy = false;
+		mc->traj.Pos = mc->Steps * mc->StepToRad;
+		mc->traj.Vel = 0;
+		mc->traj.Acc = 0;
+		mc->Mode = MotionMode_Position;
+	}
+}
+
+/*
+ *	对称的7段S曲线,静止到静止
+ *	距离不够时先去掉匀速段,再降低峰值速度,最后去掉匀加速段
+ */
+bool MotionTrajPlan(MotionTraj *tr,float start,float target,float vmax,float amax,float jmax)
+{
+	float d = fabsf(target - start);
+	float v = vmax,tj,ta;
+
+	tr->Start = start;
+	tr->Target = target;
+	tr->Pos = start;
+	tr->Vel = 0;
+	tr->Acc = 0;
+	tr->Time = 0;
+	tr->Busy = false;
+	if(d <= 0)
+		return false;
+	if(v*jmax < amax*amax)
+	{
+		tj = sqrtf(v/jmax);
+		ta = 2*tj;
+	}else
+	{
+		tj = amax/jmax;
+		ta = v/amax + tj;
+	}
+	if(v*ta > d)
+	{
+		//v*(v/amax + amax/jmax) = d
+		v = 0.5f*amax*(sqrtf(amax*amax/(jmax*jmax) + 4*d/amax) - amax/jmax);
+		if(v*jmax < amax*amax)
+		{
+			//2*v*sqrt(v/jmax) = d
+			v = powf(0.5f*d*sqrtf(jmax),2.0f/3);
+			tj = sqrtf(v/jmax);
+			ta = 2*tj;
+		}else
+		{
+			tj = amax/jmax;
+			ta = v/amax + tj;
+		}
+	}
+	tr->T[0] = tj;
+	tr->T[1] = ta - 2*tj;
+	tr->T[2] = v*ta < d ? (d - v*ta)/v : 0;
+	tr->Jerk = target > start ? jmax : -jmax;
+	tr->Busy = true;
+	return true;
+}
+
+/*
+ *	按段内常加加速度精确积分,dt跨段时分段积分,走完后落在目标上
+ */
+FAST_CODE void MotionTrajStep(MotionTraj *tr,float dt)
+{
+	static const int8_t jerk[7] = {1,0,-1,0,-1,0,1};
+	float end = 0;
+
+	if(!tr->Busy)
+		return;
+	for(uint8_t seg = 0;seg<7 && dt > 0;seg++)
+	{
+		float h,j;
+		end += tr->T[seg == 3 ? 2 : (seg & 1)];
+		if(tr->Time >= end)
+			continue;
+		h = end - tr->Time;
+		if(h > dt)
+			h = dt;
+		j = jerk[seg] * tr->Jerk;
+		tr->Pos += (tr->Vel + (tr->Acc*0.5f + j*h*(1.0f/6))*h)*h;
+		tr->Vel += (tr->Acc + j*h*0.5f)*h;
+		tr->Acc += j*h;
+		tr->Time += h;
+		dt -= h;
+	}
+	if(dt > 0)
+	{
+		tr->Pos = tr->Target;
+		tr->Vel = 0;
+		tr->Acc = 0;
+		tr->Busy = false;
+	}
+}
+
+/*
+ *	位置环:P加轨迹速度前馈,给出速度环给定
+ */
+FAST_CODE static void MotionPosition(MotionCtrl *mc)
+{
+	mc->Pos = mc->Steps * mc->StepToRad;
+	if(mc->Mode != MotionMode_Position)
+	{
+		mc->VelRef = mc->SpeedCmd;
+	}else
+	{
+		if(mc->MovePending && !mc->traj.Busy)
+		{
+			mc->MovePending = false;
+			MotionTrajPlan(&mc->traj,mc->traj.Pos,mc->MoveTarget,MOTION_TRAJ_VMAX,MOTION_TRAJ_AMAX,MOTION_TRAJ_JMAX);
+		}
+		MotionTrajStep(&mc->traj,mc->PosDiv * motor.pwm_Ts);
+		mc->VelRef = mc->traj.Vel + mc->PosKp * (mc->traj.Pos - mc->Pos);
+	}
+	Constrain(mc->VelRef,-MOTION_VEL_MAX,MOTION_VEL_MAX);
+}
+
+/*
+ *	速度环:位置差分测速,PI加轨迹加速度前馈,给出Iq
+ */
+FAST_CODE static void MotionVelocity(MotionCtrl *mc)
+{
+	float vel = (mc->Steps - mc->StepsVel) * mc->StepToRad / (mc->VelDiv * motor.pwm_Ts);
+	float iq;
+
+	mc->StepsVel = mc->Steps;
+	mc->Vel += mc->VelK * (vel - mc->Vel);
+	mc->pi_vel.OutMax = motor_foc.Imax;
+	iq = PIRegulatorRun(&mc->pi_vel,mc->VelRef - mc->Vel);
+	if(mc->Mode == MotionMode_Position)
+		iq += mc->AccToIq * mc->traj.Acc;
+	Constrain(iq,-motor_foc.Imax,motor_foc.Imax);
+	motor_foc.Iq_ref = iq;
+}
+
+/*
+ *	电流环之后每个PWM周期调用,给出的Iq下个周期生效
+ *	关闭时仍展开角度,切到闭环时位置不跳
+ */
+FAST_CODE void MotionRun(MotionCtrl *mc)
+{
+	int32_t d;
+
+	if(!mc->Active)
+		MotionReset(mc);
+	d = ((motor_foc.Theta - mc->ThetaLast + SvpwmDriverRad_half) & SvpwmDriverRad_mask) - SvpwmDriverRad_half;
+	mc->ThetaLast = motor_foc.Theta;
+	mc->Steps += d;
+	MotionRequest(mc);
+	if(mc->Mode == MotionMode_Off)
+		return;
+	if(++mc->PosCount >= mc->PosDiv)
+	{
+		mc->PosCount = 0;
+		MotionPosition(mc);
+	}
+	if(++mc->VelCount >= mc->VelDiv)
+	{
+		mc->VelCount = 0;
+		MotionVelocity(mc);
+	}
+}
@@ -0,0 +1,89 @@
+/*
+ * motion.h
+ *
+ *  电流环之上的位置/速度环,PWM分频运行,位置用S曲线轨迹
+ */
+
+#ifndef __MOTION_H_
+#define __MOTION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "current.h"
+
+#define MOTION_POS_DIV			20			//位置环每N个PWM周期一次,1kHz
+#define MOTION_VEL_DIV			4			//速度环每N个PWM周期一次,5kHz
+#define MOTION_DIV_MAX			100			//协议可改的分频上限
+#define MOTION_INERTIA			2e-5f		//转子+负载惯量 kg*m^2,加速度前馈和速度环增益用
+#define MOTION_VEL_BW_HZ		100.0f		//速度环带宽
+#define MOTION_POS_BW_HZ		20.0f		//位置环带宽,低于速度环的1/4
+#define MOTION_VEL_FILTER_HZ	400.0f		//位置差分测速的低通
+#define MOTION_VEL_MAX			40.0f		//速度环给定限幅 rad/s 机械角
+#define MOTION_TRAJ_VMAX		20.0f		//轨迹最大速度 rad/s
+#define MOTION_TRAJ_AMAX		2000.0f		//轨迹最大加速度 rad/s^2
+#define MOTION_TRAJ_JMAX		200000.0f	//轨迹最大加加速度 rad/s^3
+
+typedef enum{
+	MotionMode_Off = 0,			//只有电流环,Iq_ref由外部给
+	MotionMode_Speed,
+	MotionMode_Position,
+}MotionMode;
+
+/*
+ *	T[0]加加速时间,T[1]匀加速段,T[2]匀速段;段序 +J 0 -J 0 -J 0 +J
+ */
+typedef struct{
+	bool	Busy;
+	float	Jerk;				//带方向
+	float	T[3];
+	float	Time;				//本次运动已走的时间
+	float	Start;
+	float	Target;
+	float	Pos;				//给定位置/速度/加速度
+	float	Vel;
+	float	Acc;
+}MotionTraj;
+
+typedef struct{
+	uint8_t	Mode;
+	uint8_t	PosDiv;
+	uint8_t	VelDiv;
+	uint8_t	PosCount;
+	uint8_t	VelCount;
+
+	uint16_t ThetaLast;
+	int32_t	Steps;				//展开的电角度,4096/电周期
+	int32_t	StepsVel;			//上次测速时的Steps
+	float	StepToRad;			//Steps到机械角
+
+	float	Pos;				//反馈 rad,rad/s
+	float	Vel;
+	float	VelK;				//测速低通系数
+
+	float	PosKp;				//1/s
+	PIRegulator	pi_vel;			//A per rad/s,输出限幅Imax
+	float	AccToIq;			//J/Kt
+
+	float	VelRef;
+	float	SpeedCmd;			//速度模式的给定
+	volatile bool	SpeedPending;	//任务置位,中断切到速度模式
+	volatile bool	MovePending;	//任务置位,中断切到位置模式并规划
+	float	MoveTarget;
+	bool	Active;				//CurrentLoopReset清掉,电流环重新运行时先复位
+	MotionTraj	traj;
+}MotionCtrl;
+
+extern MotionCtrl motor_motion;
+
+void MotionInit(MotionCtrl *mc);
+void MotionGainUpdate(MotionCtrl *mc);
+void MotionReset(MotionCtrl *mc);
+void MotionSpeed(MotionCtrl *mc,float speed);
+void MotionMove(MotionCtrl *mc,float target);
+uint8_t MotionSetPosDiv(MotionCtrl *mc,int32_t div);
+uint8_t MotionSetVelDiv(MotionCtrl *mc,int32_t div);
+bool MotionTrajPlan(MotionTraj *tr,float start,float target,float vmax,float amax,float jmax);
+void MotionTrajStep(MotionTraj *tr,float dt);
+void MotionRun(MotionCtrl *mc);
+
+#endif /* __MOTION_H_ */
@@ -0,0 +1,274 @@
+/*
+ * motorident.c
+ *
+ *  Rs/Ld/Lq/磁链自整定,每个电流环中断一步
+ *  LSM_Plus用double累加(M4软件实现,约1us每点),只在辨识期间运行
+ */
+#include "motorident.h"
+#include <math.h>
+#include <string.h>
+#include "current.h"
+#include "motordriver.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+#define MOTOR_IDENT_COUNT(ms)	((uint32_t)(ms)*PWM_FREQUENCE_VAL/1000)
+
+//任务调用,下一次中断里开始
+void MotorIdentStart(MotorIdent *mi)
+{
+	mi->Request = true;
+}
+
+static void MotorIdentLsmAdd(MotorIdent *mi,float x,float y)
+{
+	LSM_Plus(x,y,&mi->Lsm.SumX,&mi->Lsm.SumX2,&mi->Lsm.SumY,&mi->Lsm.SumXY,&mi->Lsm.SumY2);
+	mi->Lsm.N += 1;
+}
+
+/*
+ *	斜率须为正且相关系数不低于MOTOR_IDENT_FIT_MIN,分母为0时得到NaN同样失败
+ */
+static bool MotorIdentLsmSlope(MotorIdent *mi,float *k)
+{
+	float b;
+	LSM_Output(mi->Lsm.N,mi->Lsm.SumX,mi->Lsm.SumX2,mi->Lsm.SumY,mi->Lsm.SumXY,mi->Lsm.SumY2,k,&b,&mi->Fit);
+	return *k > 0 && mi->Fit >= MOTOR_IDENT_FIT_MIN;
+}
+
+/*
+ *	上周期实际作用的alpha/beta电压,取调制器由脉宽重构的值
+ *	已含母线电压,死区损失和PhasePulseMax相对Period的比例,比给定电压准
+ */
+static void MotorIdentApplied(float *ualpha,float *ubeta)
+{
+#if SMO_FIXED_POINT
+	float ua = motor_Estimate.Uan_Q15 * (SMO_U_BASE/VALUE_Q15);
+	float ub = motor_Estimate.Ubn_Q15 * (SMO_U_BASE/VALUE_Q15);
+#else
+	float ua = motor_Estimate.Uan_pu;
+	float ub = motor_Estimate.Ubn_pu;
+#endif
+	*ualpha = ua;
+	*ubeta = (ua + 2*ub) / 1.7321f;
+}
+
+static void MotorIdentNext(MotorIdent *mi,uint8_t stage)
+{
+	mi->Stage = stage;
+	mi->Count = 0;
+	memset(&mi->Lsm,0,sizeof(mi->Lsm));
+}
+
+static void MotorIdentRestore(MotorIdent *mi)
+{
+	motor_foc.Enable = mi->FocEnable;
+	motor_foc.fw.Enable = mi->FwEnable;
+	motor_foc.ThetaSource = mi->ThetaSource;
+	motor_foc.ThetaStep = mi->ThetaStep;
+	motor_foc.Id_ref = mi->Id_ref;
+	motor_foc.Iq_ref = mi->Iq_ref;
+	CurrentLoopReset();
+}
+
+static void MotorIdentFail(MotorIdent *mi)
+{
+	mi->FailStage = mi->Stage;
+	MotorIdentRestore(mi);
+	MotorIdentNext(mi,MotorIdentStage_Fail);
+	svpwmDri.outPutAlphaBeta(svpwmID,0,0);
+}
+
+static void MotorIdentOutput(MotorIdent *mi,float ualpha,float ubeta)
+{
+	Constrain(ualpha,-motor_foc.Umax,motor_foc.Umax);
+	Constrain(ubeta,-motor_foc.Umax,motor_foc.Umax);
+	motor_foc.Ualpha_out = ualpha;
+	motor_foc.Ubeta_out = ubeta;
+	svpwmDri.outPutAlphaBeta(svpwmID,(int32_t)(ualpha * motor_foc.VoltToQ15),(int32_t)(ubeta * motor_foc.VoltToQ15));
+}
+
+static void MotorIdentBegin(MotorIdent *mi)
+{
+	mi->FocEnable = motor_foc.Enable;
+	mi->FwEnable = motor_foc.fw.Enable;
+	mi->ThetaSource = motor_foc.ThetaSource;
+	mi->ThetaStep = motor_foc.ThetaStep;
+	mi->Id_ref = motor_foc.Id_ref;
+	mi->Iq_ref = motor_foc.Iq_ref;
+	mi->UTest = 0;
+	mi->FailStage = MotorIdentStage_Idle;
+	CurrentLoopReset();
+	MotorIdentNext(mi,MotorIdentStage_Ramp);
+}
+
+/*
+ *	DC电压分档,alpha轴电压对电流拟合
+ */
+static void MotorIdentRs(MotorIdent *mi,float ialpha,const float *u)
+{
+	if(mi->Count > MOTOR_IDENT_COUNT(MOTOR_IDENT_SETTLE_MS))
+		MotorIdentLsmAdd(mi,ialpha,u[0]);
+	if(mi->Count >= MOTOR_IDENT_COUNT(MOTOR_IDENT_SETTLE_MS + MOTOR_IDENT_AVG_MS))
+	{
+		mi->Count = 0;
+		if(++mi->Level >= MOTOR_IDENT_RS_LEVELS)
+		{
+			if(!MotorIdentLsmSlope(mi,&mi->Rs))
+			{
+				MotorIdentFail(mi);
+				return;
+			}
+			MotorIdentNext(mi,MotorIdentStage_Ld);
+			MotorIdentOutput(mi,mi->UTest,0);
+			return;
+		}
+	}
+	MotorIdentOutput(mi,mi->UTest * (1 - MOTOR_IDENT_RS_SPAN * mi->Level / (MOTOR_IDENT_RS_LEVELS - 1)),0);
+}
+
+/*
+ *	u = Rs*i + L*di/dt,上周期的电压作用在两次采样之间,电流取两次的平均
+ *	第一个方波周期等电流进入稳态,不参与拟合
+ */
+static void MotorIdentL(MotorIdent *mi,float ialpha,float ibeta,const float *u)
+{
+	uint8_t axis = mi->Stage == MotorIdentStage_Lq;
+	float i = axis ? ibeta : ialpha;
+	float du;
+
+	if(mi->Count > 2*MOTOR_IDENT_L_HALF)
+		MotorIdentLsmAdd(mi,(i - mi->IPrev) * motor.pwm_freq,u[axis] - mi->Rs * 0.5f * (i + mi->IPrev));
+	mi->IPrev = i;
+	if(mi->Count >= MOTOR_IDENT_COUNT(MOTOR_IDENT_L_MS))
+	{
+		if(!MotorIdentLsmSlope(mi,axis ? &mi->Lq : &mi->Ld))
+		{
+			MotorIdentFail(mi);
+			return;
+		}
+		if(axis)
+		{
+			//观测器和PI在拖动前换成辨识值
+			motor.Motor_Rs_pu = mi->Rs;
+			motor.Motor_Ld_pu = mi->Ld;
+			motor.Motor_Lq_pu = mi->Lq;
+			MotorParamUpdate();
+			MotorIdentNext(mi,MotorIdentStage_SpinUp);
+			MotorIdentOutput(mi,mi->UTest,0);
+			return;
+		}
+		MotorIdentNext(mi,MotorIdentStage_Lq);
+	}
+	du = ((mi->Count / MOTOR_IDENT_L_HALF) & 1) ? -MOTOR_IDENT_L_INJECT * mi->UTest : MOTOR_IDENT_L_INJECT * mi->UTest;
+	if(mi->Stage == MotorIdentStage_Lq)
+		MotorIdentOutput(mi,mi->UTest,du);
+	else
+		MotorIdentOutput(mi,mi->UTest + du,0);
+}
+
+/*
+ *	零电流下电压就是反电动势,|U-Rs*I|对观测器转速拟合,与坐标系无关
+ */
+static void MotorIdentCoast(MotorIdent *mi,float ialpha,float ibeta,const float *u)
+{
+	float w = fabsf(motor_Estimate.Omega_estimate);
+	float ea = u[0] - mi->Rs * ialpha;
+	float eb = u[1] - mi->Rs * ibeta;
+
+	if(mi->Count <= MOTOR_IDENT_COUNT(MOTOR_IDENT_COAST_SKIP_MS))
+		return;
+	MotorIdentLsmAdd(mi,w,sqrtf(ea*ea + eb*eb));
+	if(w > MOTOR_IDENT_COAST_W_MIN && mi->Count < MOTOR_IDENT_COUNT(MOTOR_IDENT_COAST_SKIP_MS + MOTOR_IDENT_COAST_MS))
+		return;
+	if(!MotorIdentLsmSlope(mi,&mi->Flux))
+	{
+		MotorIdentFail(mi);
+		return;
+	}
+	motor.Motor_Flux = mi->Flux;
+	MotorIdentRestore(mi);
+	MotorIdentNext(mi,MotorIdentStage_Done);
+}
+
+/*
+ *	电流环中断里在观测器之后调用
+ *	返回true表示本周期的电压已由辨识输出,false时照常运行电流环
+ *	(转动阶段借用电流环,只改它的给定)
+ */
+FAST_CODE bool MotorIdentRun(MotorIdent *mi)
+{
+	float ialpha = motor_fbk.Ialpha_fbk_pu;
+	float ibeta = motor_fbk.Ibeta_fbk_pu;
+	float u[2];
+
+	if(mi->Request)
+	{
+		mi->Request = false;
+		MotorIdentBegin(mi);
+	}
+	if(mi->Stage == MotorIdentStage_Idle || mi->Stage >= MotorIdentStage_Done)
+		return false;
+	MotorIdentApplied(&u[0],&u[1]);
+	mi->Count++;
+	switch(mi->Stage)
+	{
+		case MotorIdentStage_Ramp:
+			if(ialpha >= MOTOR_IDENT_I_TEST)
+			{
+				MotorIdentNext(mi,MotorIdentStage_Align);
+			}else if(mi->UTest >= motor_foc.Umax)
+			{
+				//开相或者电阻过大
+				MotorIdentFail(mi);
+				return true;
+			}else
+			{
+				mi->UTest += MOTOR_IDENT_RAMP_V_S * motor.pwm_Ts;
+			}
+			MotorIdentOutput(mi,mi->UTest,0);
+			return true;
+		case MotorIdentStage_Align:
+			if(mi->Count >= MOTOR_IDENT_COUNT(MOTOR_IDENT_ALIGN_MS))
+			{
+				mi->Level = 0;
+				MotorIdentNext(mi,MotorIdentStage_Rs);
+			}
+			MotorIdentOutput(mi,mi->UTest,0);
+			return true;
+		case MotorIdentStage_Rs:
+			MotorIdentRs(mi,ialpha,u);
+			return true;
+		case MotorIdentStage_Ld:
+		case MotorIdentStage_Lq:
+			MotorIdentL(mi,ialpha,ibeta,u);
+			return true;
+		case MotorIdentStage_SpinUp:
+			//转子已对齐在alpha轴,从0角度开环拖动
+			if(mi->Count == 1)
+			{
+				motor_foc.ThetaSource = FocThetaSource_OpenLoop;
+				motor_foc.Theta = 0;
+				motor_foc.ThetaStep = 0;
+				motor_foc.Id_ref = MOTOR_IDENT_SPIN_ID;
+				motor_foc.Iq_ref = 0;
+				motor_foc.fw.Enable = false;
+				motor_foc.Enable = true;
+				CurrentLoopReset();
+			}
+			if(mi->Count % MOTOR_IDENT_COUNT(MOTOR_IDENT_SPIN_RAMP_MS) == 0 && motor_foc.ThetaStep < MOTOR_IDENT_SPIN_STEP)
+				motor_foc.ThetaStep++;
+			if(mi->Count >= MOTOR_IDENT_COUNT(MOTOR_IDENT_SPIN_RAMP_MS)*MOTOR_IDENT_SPIN_STEP + MOTOR_IDENT_COUNT(MOTOR_IDENT_SPIN_HOLD_MS))
+			{
+				motor_foc.ThetaSource = FocThetaSource_Observer;
+				motor_foc.Id_ref = 0;
+				MotorIdentNext(mi,MotorIdentStage_Coast);
+			}
+			return false;
+		case MotorIdentStage_Coast:
+			MotorIdentCoast(mi,ialpha,ibeta,u);
+			return false;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * motorident.h
+ *
+ *  电机参数自整定Rs/Ld/Lq/磁链,在电流环中断里运行,最小二乘拟合
+ */
+
+#ifndef __MOTORIDENT_H_
+#define __MOTORIDENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MOTOR_IDENT_I_TEST			1.0f		//Rs测试电流 A,电压从0升到该电流
+#define MOTOR_IDENT_RAMP_V_S		20.0f		//升压速率 V/s
+#define MOTOR_IDENT_ALIGN_MS		300			//到测试电流后等转子对齐
+#define MOTOR_IDENT_RS_LEVELS		4			//Rs电压档数,从UTest降到(1-SPAN)*UTest
+#define MOTOR_IDENT_RS_SPAN			0.5f		//电流不过零,死区压降只进截距
+#define MOTOR_IDENT_SETTLE_MS		20			//每档稳定时间
+#define MOTOR_IDENT_AVG_MS			20			//每档采集时间
+#define MOTOR_IDENT_L_INJECT		0.3f		//电感注入方波幅值,相对UTest
+#define MOTOR_IDENT_L_HALF			10			//方波半周期,PWM周期数
+#define MOTOR_IDENT_L_MS			50			//每轴注入时间
+#define MOTOR_IDENT_SPIN_ID			0.4f		//开环拖动电流 A
+#define MOTOR_IDENT_SPIN_STEP		16			//拖动到的每周期角度增量 0-4096
+#define MOTOR_IDENT_SPIN_RAMP_MS	40			//角度增量每隔该时间加1
+#define MOTOR_IDENT_SPIN_HOLD_MS	200
+#define MOTOR_IDENT_COAST_SKIP_MS	50			//切到零电流后等电流环和观测器稳定
+#define MOTOR_IDENT_COAST_MS		500
+#define MOTOR_IDENT_COAST_W_MIN		100.0f		//电角速度低于该值结束 rad/s
+#define MOTOR_IDENT_FIT_MIN			0.9f		//拟合相关系数下限
+
+typedef enum{
+	MotorIdentStage_Idle = 0,
+	MotorIdentStage_Ramp,
+	MotorIdentStage_Align,
+	MotorIdentStage_Rs,
+	MotorIdentStage_Ld,
+	MotorIdentStage_Lq,
+	MotorIdentStage_SpinUp,
+	MotorIdentStage_Coast,
+	MotorIdentStage_Done,
+	MotorIdentStage_Fail,
+}MotorIdentStage;
+
+typedef struct{
+	double N;
+	double SumX;
+	double SumX2;
+	double SumY;
+	double SumXY;
+	double SumY2;
+}MotorIdentLsm;
+
+typedef struct{
+	volatile bool Request;
+	uint8_t	Stage;
+	uint8_t	FailStage;			//失败时所在的阶段
+	uint8_t	Level;
+	uint32_t Count;				//本阶段已运行的PWM周期数
+	float	UTest;				//达到测试电流的alpha轴电压
+	float	IPrev;
+	MotorIdentLsm Lsm;
+
+	//辨识期间接管的电流环设置,结束后恢复
+	bool	FocEnable;
+	bool	FwEnable;
+	uint8_t	ThetaSource;
+	uint16_t ThetaStep;
+	float	Id_ref;
+	float	Iq_ref;
+
+	float	Rs;
+	float	Ld;
+	float	Lq;
+	float	Flux;
+	float	Fit;				//最近一次拟合的相关系数
+}MotorIdent;
+
+void MotorIdentStart(MotorIdent *mi);
+bool MotorIdentRun(MotorIdent *mi);
+
+#endif /* __MOTORIDENT_H_ */
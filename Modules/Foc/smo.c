@@ -0,0 +1,106 @@
+/*
+ * smo.c
+ *
+ *  定点滑模观测器
+ */
+#include "smo.h"
+#include <string.h>
+#include "fastmem.h"
+
+/* 系数用double计算,避免目标板float乘加融合带来的舍入差异 */
+static Q30 SmoQ30(double x)
+{
+	return (Q30)(x*VALUE_Q30 + (x < 0 ? -0.5 : 0.5));
+}
+
+void SmoQ15Init(SmoQ15 *smo,float Rs,float Ls,float Ts,float kctrl,float Klsf,float uBase,float iBase)
+{
+	memset(smo,0,sizeof(SmoQ15));
+	smo->Fctrl = SmoQ30(1 - (double)Rs*Ts/Ls);
+	smo->Gctrl = SmoQ30((double)Ts/Ls*uBase/iBase);
+	smo->kctrl = SmoQ30((double)kctrl*iBase/uBase);
+	smo->Klsf = SmoQ30(Klsf);
+}
+
+/*
+ *	bwHz为锁相环自然频率,阻尼0.707
+ *	Kp = 2*zeta*wn	Ki = wn^2,换算到每采样的2^32/圈角度单位
+ */
+void SmoQ15PllInit(SmoQ15 *smo,float bwHz,float eMin,float Ts,float uBase)
+{
+	double wn = 2*3.14159265358979*bwHz;
+	double unit = 4294967296.0/(2*3.14159265358979);
+
+	smo->PllKp = (int32_t)(2*0.707*wn*Ts*unit + 0.5);
+	smo->PllKi = (int32_t)(wn*wn*Ts*Ts*unit + 0.5);
+	smo->PllEMin = (Q24)((double)eMin/uBase*VALUE_Q24 + 0.5);
+	smo->PllTheta = 0;
+	smo->PllOmega = 0;
+}
+
+#if SMO_ANGLE_PLL
+/*
+ *	E = w*flux*(-sin(theta),cos(theta))
+ *	q = -Ealpha*cos(theta_pll) - Ebeta*sin(theta_pll) = |E|*sin(theta - theta_pll)
+ *	用|E|归一化,乘转速符号,正反转都锁在同一相位
+ */
+FAST_CODE static void SmoQ15PllUpdate(SmoQ15 *smo)
+{
+	Q15 s,c;
+	int32_t q,d,absq,absd,mag;
+
+	SinCosQ15(smo->PllTheta >> 20,&s,&c);
+	q = -SMO_MUL_Q15(smo->Ealpha_estimate_filt,c) - SMO_MUL_Q15(smo->Ebeta_estimate_filt,s);
+	d = SMO_MUL_Q15(smo->Ebeta_estimate_filt,c) - SMO_MUL_Q15(smo->Ealpha_estimate_filt,s);
+
+	//|E| ~= max + 3/8*min,误差<7%
+	absq = q < 0 ? -q : q;
+	absd = d < 0 ? -d : d;
+	mag = absq > absd ? absq + ((absd*3)>>3) : absd + ((absq*3)>>3);
+	if(mag < smo->PllEMin)
+		mag = smo->PllEMin;
+	if(mag >= VALUE_Q15)
+	{
+		uint8_t sh = 17 - __builtin_clz(mag);
+		q >>= sh;
+		mag >>= sh;
+	}
+	smo->PllErr = q*VALUE_Q15/mag;
+	Constrain(smo->PllErr,-(VALUE_Q15-1),VALUE_Q15-1);
+	if(smo->PllOmega < 0)
+		smo->PllErr = -smo->PllErr;
+
+	smo->PllOmega += SMO_MUL_Q15(smo->PllKi,smo->PllErr);
+	smo->PllTheta += smo->PllOmega + SMO_MUL_Q15(smo->PllKp,smo->PllErr);
+	smo->Theta = smo->PllTheta >> 20;
+}
+#endif
+
+FAST_CODE void SmoQ15Update(SmoQ15 *smo,Q15 ialpha,Q15 ibeta,Q15 ualpha,Q15 ubeta)
+{
+	ialpha = SMO_Q15_TO_Q24(ialpha);
+	ibeta = SMO_Q15_TO_Q24(ibeta);
+	ualpha = SMO_Q15_TO_Q24(ualpha);
+	ubeta = SMO_Q15_TO_Q24(ubeta);
+
+	smo->Ialpha_estimate = SMO_MUL_Q30(smo->Gctrl,ualpha - smo->Ealpha_estimate - smo->Adjust_alpha) + SMO_MUL_Q30(smo->Fctrl,smo->Ialpha_estimate);
+	smo->Ibeta_estimate = SMO_MUL_Q30(smo->Gctrl,ubeta - smo->Ebeta_estimate - smo->Adjust_beta) + SMO_MUL_Q30(smo->Fctrl,smo->Ibeta_estimate);
+	//计算电流的误差
+	smo->Ialpha_err = smo->Ialpha_estimate - ialpha;
+	smo->Ibeta_err = smo->Ibeta_estimate - ibeta;
+
+	smo->Adjust_alpha = SMO_MUL_Q30(smo->kctrl,smo->Ialpha_err);
+	smo->Adjust_beta = SMO_MUL_Q30(smo->kctrl,smo->Ibeta_err);
+
+	smo->Ealpha_estimate += SMO_MUL_Q30(smo->Klsf,smo->Adjust_alpha - smo->Ealpha_estimate);
+	smo->Ebeta_estimate += SMO_MUL_Q30(smo->Klsf,smo->Adjust_beta - smo->Ebeta_estimate);
+
+	smo->Ealpha_estimate_filt += SMO_MUL_Q30(smo->Klsf,smo->Ealpha_estimate - smo->Ealpha_estimate_filt);
+	smo->Ebeta_estimate_filt += SMO_MUL_Q30(smo->Klsf,smo->Ebeta_estimate - smo->Ebeta_estimate_filt);
+
+#if SMO_ANGLE_PLL
+	SmoQ15PllUpdate(smo);
+#else
+	smo->Theta = Atan2Q12(-smo->Ealpha_estimate_filt,smo->Ebeta_estimate_filt);
+#endif
+}
@@ -0,0 +1,55 @@
+/*
+ * smo.h
+ *
+ *  定点滑模观测器,与motor_estimat_theta同方程,Q15输入/Q30系数/Q24状态
+ */
+
+#ifndef __SMO_H_
+#define __SMO_H_
+
+#include <stdint.h>
+#include "myMath.h"
+
+#define SMO_MUL_Q30(c,x)	((int32_t)(((int64_t)(c)*(x))>>30))
+#define SMO_MUL_Q15(a,b)	((int32_t)(((int64_t)(a)*(b))>>15))
+#define SMO_Q15_TO_Q24(x)	((x)*(1<<9))
+
+#ifndef SMO_ANGLE_PLL
+#define SMO_ANGLE_PLL		1			//1:反电动势锁相环求角度和转速 0:atan2
+#endif
+
+typedef struct{
+	//系数
+	Q30 Fctrl;			//1 - R*Ts/L
+	Q30 Gctrl;			//Ts/L	(pu)
+	Q30 kctrl;			//(pu)
+	Q30 Klsf;			//低通滤波器系数
+
+	//状态
+	Q24 Ialpha_estimate;
+	Q24 Ibeta_estimate;
+	Q24 Ialpha_err;
+	Q24 Ibeta_err;
+	Q24 Adjust_alpha;
+	Q24 Adjust_beta;
+	Q24 Ealpha_estimate;
+	Q24 Ebeta_estimate;
+	Q24 Ealpha_estimate_filt;
+	Q24 Ebeta_estimate_filt;
+
+	//锁相环,角度单位2^32一圈
+	Q24 PllEMin;		//反电动势幅值下限,防止低速时鉴相增益发散
+	int32_t PllKp;		//每采样角度增量/Q15误差
+	int32_t PllKi;
+	Q15 PllErr;			//sin(theta - theta_pll)
+	uint32_t PllTheta;
+	int32_t PllOmega;	//每采样的角度增量
+
+	uint16_t Theta;		//0-4096	0-2*pi
+}SmoQ15;
+
+void SmoQ15Init(SmoQ15 *smo,float Rs,float Ls,float Ts,float kctrl,float Klsf,float uBase,float iBase);
+void SmoQ15PllInit(SmoQ15 *smo,float bwHz,float eMin,float Ts,float uBase);
+void SmoQ15Update(SmoQ15 *smo,Q15 ialpha,Q15 ibeta,Q15 ualpha,Q15 ubeta);
+
+#endif /* __SMO_H_ */
@@ -0,0 +1,202 @@
+/*
+ * startup.c
+ *
+ *  对齐/I/F拖动/观测器校验/角度过渡,每个电流环中断一步
+ */
+#include "startup.h"
+#include <math.h>
+#include <string.h>
+#include "svpwm.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+#define STARTUP_COUNT(ms)	((uint32_t)(ms)*PWM_FREQUENCE_VAL/1000)
+
+/*
+ *	MotorInit里调用,加速度和终点转速可在开始前改
+ */
+void MotorStartupInit(MotorStartup *su)
+{
+	memset(su,0,sizeof(MotorStartup));
+	su->Stage = MotorStartupStage_Idle;
+	su->Current = STARTUP_CURRENT;
+	su->Acc = STARTUP_ACC;
+	su->OmegaEnd = STARTUP_OMEGA;
+	su->ErrK = 2*PI*STARTUP_CHECK_FILTER_HZ / PWM_FREQUENCE_VAL;
+	su->DampLpK = 2*PI*STARTUP_DAMP_LP_HZ / PWM_FREQUENCE_VAL;
+	su->DampHpK = 2*PI*STARTUP_DAMP_HP_HZ / PWM_FREQUENCE_VAL;
+}
+
+//任务调用,下一次中断里开始
+void MotorStartupStart(MotorStartup *su)
+{
+	su->Request = true;
+}
+
+static void MotorStartupNext(MotorStartup *su,uint8_t stage)
+{
+	su->Stage = stage;
+	su->Count = 0;
+}
+
+static void MotorStartupBegin(MotorStartup *su)
+{
+	su->Ticks = 0;
+	su->CloseTicks = 0;
+	su->FailStage = MotorStartupStage_Idle;
+	su->Omega = 0;
+	su->DampW = 0;
+	su->DampSlow = 0;
+	su->Phase = SvpwmDriverRad_Quart;
+	motor_foc.Theta = SvpwmDriverRad_Quart;
+	motor_foc.ThetaSource = FocThetaSource_Startup;
+	motor_foc.Id_ref = 0;
+	motor_foc.Iq_ref = 0;
+	motor_foc.Enable = true;
+	CurrentLoopReset();
+	MotorStartupNext(su,MotorStartupStage_Align);
+}
+
+//电流给零,角度停在原处
+static void MotorStartupFail(MotorStartup *su)
+{
+	su->FailStage = su->Stage;
+	su->Omega = 0;
+	motor_foc.Id_ref = 0;
+	motor_foc.Iq_ref = 0;
+	MotorStartupNext(su,MotorStartupStage_Fail);
+}
+
+FAST_CODE static void MotorStartupAdvance(MotorStartup *su)
+{
+	su->Phase += su->Omega * (SvpwmDriverRad / (2*PI)) * motor.pwm_Ts;
+	if(su->Phase >= SvpwmDriverRad)
+		su->Phase -= SvpwmDriverRad;
+	else if(su->Phase < 0)
+		su->Phase += SvpwmDriverRad;
+}
+
+/*
+ *	拖动帧q轴电压减掉电阻压降和交叉项,剩下 w_r*flux*cos(负载角)
+ *	负载角和参数误差给出的偏置由高通去掉,只留摆动,注入反向Iq
+ *	对齐时转子应静止,不做高通,负载拖着转的转速也一起阻尼掉
+ */
+FAST_CODE static void MotorStartupDamp(MotorStartup *su)
+{
+	float wr = (motor_foc.Uq_out - motor.Motor_Rs_pu * motor_foc.Iq_fbk - su->Omega * motor.Motor_Ld_pu * motor_foc.Id_fbk) / motor.Motor_Flux;
+	float dw;
+
+	su->DampW += su->DampLpK * (wr - su->DampW);
+	dw = su->DampW - su->Omega;
+	if(su->Stage != MotorStartupStage_Align)
+		su->DampSlow += su->DampHpK * (dw - su->DampSlow);
+	motor_foc.Iq_ref = -STARTUP_DAMP * (dw - su->DampSlow);
+}
+
+/*
+ *	观测转速跟上拖动转速,角度差平稳,两者同时满足才算可信
+ *	观测器是线性增益,反电动势估计不是实际幅值,不拿来判断
+ *	角度差超过90度说明转子已经失步
+ */
+FAST_CODE static bool MotorStartupConfident(MotorStartup *su,int32_t err)
+{
+	float w = fabsf(su->Omega);
+
+	if(su->Count == 1)
+	{
+		su->Err = err;
+		su->ErrDev = SvpwmDriverRad_Quart;
+	}
+	su->Err += su->ErrK * (err - su->Err);
+	su->ErrDev += su->ErrK * (fabsf(err - su->Err) - su->ErrDev);
+	if(fabsf(motor_Estimate.Omega_estimate - su->Omega) > STARTUP_CHECK_OMEGA * w)
+		return false;
+	if(su->ErrDev > STARTUP_CHECK_DEV * (SvpwmDriverRad / 360.0f))
+		return false;
+	return fabsf(su->Err) < SvpwmDriverRad_Quart;
+}
+
+/*
+ *	帧角从拖动角滑到观测角:theta = phase + k*err
+ *	拖动矢量在该帧里为 (I*cos(k*err),-I*sin(k*err)),矢量本身不动;Id同时乘(1-k)淡出
+ */
+FAST_CODE static void MotorStartupBlend(MotorStartup *su,int32_t err)
+{
+	float k = (float)su->Count / STARTUP_COUNT(STARTUP_BLEND_MS);
+	int32_t shift;
+	Q15 s,c;
+
+	if(k > 1)
+		k = 1;
+	shift = (int32_t)(k * err);
+	SinCosQ15(shift & SvpwmDriverRad_mask,&s,&c);
+	motor_foc.Theta = ((int32_t)su->Phase + shift) & SvpwmDriverRad_mask;
+	motor_foc.Id_ref = (1 - k) * su->Current * c * (1.0f/VALUE_Q15);
+	motor_foc.Iq_ref = -su->Current * s * (1.0f/VALUE_Q15);
+	if(k >= 1)
+	{
+		motor_foc.ThetaSource = FocThetaSource_Observer;
+		su->CloseTicks = su->Ticks;
+		MotorStartupNext(su,MotorStartupStage_Done);
+	}
+}
+
+/*
+ *	每个PWM周期在CurrentLoopRunning之前调用,观测器已更新
+ */
+FAST_CODE void MotorStartupRun(MotorStartup *su)
+{
+	uint32_t align = STARTUP_COUNT(STARTUP_ALIGN_MS);
+	int32_t err;
+
+	if(su->Request)
+	{
+		su->Request = false;
+		MotorStartupBegin(su);
+	}
+	if(su->Stage == MotorStartupStage_Idle || su->Stage >= MotorStartupStage_Done)
+		return;
+	su->Count++;
+	su->Ticks++;
+	switch(su->Stage)
+	{
+		case MotorStartupStage_Align:
+			motor_foc.Id_ref = su->Current * (su->Count < align/4 ? (float)su->Count / (align/4) : 1);
+			if(su->Count == align/2)
+				su->Phase = 0;
+			if(su->Count >= align)
+				MotorStartupNext(su,MotorStartupStage_Ramp);
+			break;
+		case MotorStartupStage_Ramp:
+			su->Omega += (su->OmegaEnd >= 0 ? su->Acc : -su->Acc) * motor.pwm_Ts;
+			if(fabsf(su->Omega) >= fabsf(su->OmegaEnd))
+			{
+				su->Omega = su->OmegaEnd;
+				su->CheckCount = 0;
+				MotorStartupNext(su,MotorStartupStage_Check);
+			}
+			MotorStartupAdvance(su);
+			break;
+		case MotorStartupStage_Check:
+			MotorStartupAdvance(su);
+			err = ((CurrentLoopObserverTheta() - (int32_t)su->Phase + SvpwmDriverRad_half) & SvpwmDriverRad_mask) - SvpwmDriverRad_half;
+			if(MotorStartupConfident(su,err))
+				su->CheckCount++;
+			else
+				su->CheckCount = 0;
+			if(su->CheckCount >= STARTUP_COUNT(STARTUP_CHECK_MS))
+				MotorStartupNext(su,MotorStartupStage_Blend);
+			else if(su->Count >= STARTUP_COUNT(STARTUP_CHECK_TIMEOUT_MS))
+				MotorStartupFail(su);
+			break;
+		case MotorStartupStage_Blend:
+			MotorStartupAdvance(su);
+			err = ((CurrentLoopObserverTheta() - (int32_t)su->Phase + SvpwmDriverRad_half) & SvpwmDriverRad_mask) - SvpwmDriverRad_half;
+			MotorStartupBlend(su,err);
+			return;
+		default:
+			return;
+	}
+	MotorStartupDamp(su);
+	motor_foc.Theta = (int32_t)su->Phase & SvpwmDriverRad_mask;
+}
@@ -0,0 +1,68 @@
+/*
+ * startup.h
+ *
+ *  无传感器启动:对齐、I/F拖动、观测器校验、平滑切换到观测器,在电流环中断里运行
+ */
+
+#ifndef __STARTUP_H_
+#define __STARTUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "current.h"
+
+#define STARTUP_CURRENT				0.4f		//对齐和拖动电流 A
+#define STARTUP_ALIGN_MS			300			//两个对齐位置各一半,电流在前1/4内升起
+#define STARTUP_ACC					3000.0f		//拖动加速度 电角速度 rad/s^2,协议可改
+#define STARTUP_OMEGA				500.0f		//拖动终点,电角速度 rad/s,负值反转
+#define STARTUP_DAMP				0.0025f		//阻尼 A per rad/s 电角速度,约2*0.5*wn*J/(1.5*pole^2*flux)
+#define STARTUP_DAMP_HP_HZ			5.0f		//转速偏差的高通,低于拖动摆动频率
+#define STARTUP_DAMP_LP_HZ			100.0f		//转速估计的低通,电流环经Uq回到Iq给定的环路增益在此之上衰减
+#define STARTUP_CHECK_MS			20			//观测器连续可信的时间
+#define STARTUP_CHECK_TIMEOUT_MS	500
+#define STARTUP_CHECK_OMEGA			0.2f		//观测转速与拖动转速的相对误差上限
+#define STARTUP_CHECK_DEV			10.0f		//观测角与拖动角之差的波动上限 deg
+#define STARTUP_CHECK_FILTER_HZ		50.0f		//角度差及其波动的低通
+#define STARTUP_BLEND_MS			50
+
+typedef enum{
+	MotorStartupStage_Idle = 0,
+	MotorStartupStage_Align,
+	MotorStartupStage_Ramp,
+	MotorStartupStage_Check,
+	MotorStartupStage_Blend,
+	MotorStartupStage_Done,
+	MotorStartupStage_Fail,
+}MotorStartupStage;
+
+typedef struct{
+	volatile bool Request;
+	uint8_t	Stage;
+	uint8_t	FailStage;			//失败时所在的阶段
+	uint32_t Count;				//本阶段已运行的PWM周期数
+	uint32_t Ticks;				//开始以来的PWM周期数
+	uint32_t CloseTicks;		//开始到切到观测器的PWM周期数
+
+	float	Current;			//A
+	float	Acc;				//rad/s^2
+	float	OmegaEnd;			//rad/s,符号为方向
+
+	float	Omega;				//拖动转速 rad/s
+	float	Phase;				//拖动角 0-4096,带小数
+	float	Err;				//观测角减拖动角,低通,0-4096步
+	float	ErrDev;				//|瞬时差-Err|的低通
+	float	ErrK;
+	float	DampW;				//由Uq估计的转子转速,低通
+	float	DampSlow;			//转速偏差的低通,减掉后为高通
+	float	DampLpK;
+	float	DampHpK;
+	uint32_t CheckCount;		//连续可信的周期数
+}MotorStartup;
+
+extern MotorStartup motor_startup;
+
+void MotorStartupInit(MotorStartup *su);
+void MotorStartupStart(MotorStartup *su);
+void MotorStartupRun(MotorStartup *su);
+
+#endif /* __STARTUP_H_ */
@@ -0,0 +1,44 @@
+/*
+ * califlash.c
+ *
+ *  校准区RAM映射和扇区重写
+ */
+#include "califlash.h"
+#include <string.h>
+#include "stm32f4xx_hal.h"
+
+uint8_t caliDataRAMMap[FlashInternCaliMemMax] __attribute__((aligned(4)));
+
+void CaliFlashLoad(void)
+{
+	memcpy(caliDataRAMMap,(const void *)FlashInterUserDataAddrBase,FlashInternCaliMemMax);
+}
+
+/*
+ *	擦除整个扇区再按字写回RAM映像,最后回读比较
+ *	擦除期间CPU从flash取指会停顿几百ms,中断也一样,调用前电机须停止输出
+ */
+bool CaliFlashSave(void)
+{
+	FLASH_EraseInitTypeDef erase = {
+		.TypeErase = FLASH_TYPEERASE_SECTORS,
+		.Sector = CALI_FLASH_SECTOR,
+		.NbSectors = 1,
+		.VoltageRange = FLASH_VOLTAGE_RANGE_3,
+	};
+	uint32_t sectorError;
+	bool ok = true;
+
+	HAL_FLASH_Unlock();
+	if(HAL_FLASHEx_Erase(&erase,&sectorError) != HAL_OK)
+		ok = false;
+	for(uint32_t i = 0;ok && i<FlashInternCaliMemMax;i += 4)
+	{
+		uint32_t word;
+		memcpy(&word,&caliDataRAMMap[i],4);
+		if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD,FlashInterUserDataAddrBase + i,word) != HAL_OK)
+			ok = false;
+	}
+	HAL_FLASH_Lock();
+	return ok && memcmp(caliDataRAMMap,(const void *)FlashInterUserDataAddrBase,FlashInternCaliMemMax) == 0;
+}
@@ -0,0 +1,19 @@
+/*
+ * califlash.h
+ *
+ *  校准flash区(扇区3)的RAM映射,上电载入,整区写回
+ */
+
+#ifndef __CALIFLASH_H_
+#define __CALIFLASH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver_stm32.h"
+
+#define CALI_FLASH_SECTOR		FLASH_SECTOR_3		//0x0800C000-0x0800FFFF,16KB
+
+void CaliFlashLoad(void);
+bool CaliFlashSave(void);
+
+#endif /* __CALIFLASH_H_ */
@@ -0,0 +1,218 @@
+/*
+ * encoderlinear.c
+ *
+ *  编码器非线性校正表的插值查表和学习,任务tick里步进
+ */
+#include "encoderlinear.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "motordriver.h"
+#include "svpwm.h"
+#include "myMath.h"
+#include "fastmem.h"
+
+/*
+ *	(ENCODER_LINEAR_POINTS<<16)/PPR取下整,pos<PPR时段号不超过POINTS-1
+ *	只改比例,表不变
+ */
+void EncoderLinearSetPPR(EncoderLinear *el,uint16_t encodePPR)
+{
+	DEBUG_Assert(encodePPR >= ENCODER_LINEAR_POINTS);
+	el->PosToSeg_Q16 = ((uint32_t)ENCODER_LINEAR_POINTS<<16) / encodePPR;
+}
+
+//correct为NULL时清零
+void EncoderLinearSet(EncoderLinear *el,const int16_t *correct)
+{
+	if(correct == NULL)
+	{
+		memset(el->Correct,0,sizeof(el->Correct));
+		return;
+	}
+	memcpy(el->Correct,correct,ENCODER_LINEAR_POINTS*sizeof(int16_t));
+	el->Correct[ENCODER_LINEAR_POINTS] = correct[0];
+}
+
+/*
+ *	pos为编码器原始读数,返回要加上的校正量,1/16计数
+ *	小数取12位,差值乘小数不超过2^28
+ */
+FAST_CODE int32_t EncoderLinearCorrect(const EncoderLinear *el,uint16_t pos)
+{
+	uint32_t x = pos * el->PosToSeg_Q16;
+	const int16_t *c = &el->Correct[x>>16];
+	int32_t frac = (x & 0xFFFF)>>4;
+
+	return c[0] + (((c[1] - c[0]) * frac)>>12);
+}
+
+static uint32_t EncoderLinearCheckSum(const EncoderLinearRecord *rec)
+{
+	return CalculateCheckSum((unsigned char *)rec,offsetof(EncoderLinearRecord,CheckSum));
+}
+
+/*
+ *	addr为标定数据RAM映像里的记录地址,magic或校验不对时不改correct
+ */
+bool EncoderLinearLoad(int16_t *correct,uint8_t axis,uint32_t addr)
+{
+	const EncoderLinearRecord *rec = (const EncoderLinearRecord *)addr;
+
+	DEBUG_Assert(axis < ENCODER_LINEAR_AXIS_NUM);
+	if(rec->Magic != ENCODER_LINEAR_MAGIC || rec->CheckSum != EncoderLinearCheckSum(rec))
+		return false;
+	memcpy(correct,rec->Correct[axis],sizeof(rec->Correct[axis]));
+	return true;
+}
+
+//只改一个轴,其他轴保留;记录无效时其他轴清零
+void EncoderLinearStore(uint32_t addr,uint8_t axis,const int16_t *correct)
+{
+	EncoderLinearRecord *rec = (EncoderLinearRecord *)addr;
+
+	DEBUG_Assert(axis < ENCODER_LINEAR_AXIS_NUM);
+	if(rec->Magic != ENCODER_LINEAR_MAGIC || rec->CheckSum != EncoderLinearCheckSum(rec))
+		memset(rec,0,sizeof(EncoderLinearRecord));
+	rec->Magic = ENCODER_LINEAR_MAGIC;
+	memcpy(rec->Correct[axis],correct,sizeof(rec->Correct[axis]));
+	rec->CheckSum = EncoderLinearCheckSum(rec);
+}
+
+void EncoderLinearClear(uint32_t addr)
+{
+	memset((void *)addr,0xFF,sizeof(EncoderLinearRecord));
+}
+
+static void EncoderLinearCaliFinish(EncoderLinearCali *elc,uint8_t stage)
+{
+	svpwmDri.outPut(elc->SvpwmId,0,0,0,false);
+	svpwmDri.releaseUse(elc->SvpwmId);
+	elc->Stage = stage;
+}
+
+/*
+ *	占用svpwm驱动,电流环在学习期间不输出
+ *	矢量从-余量转到一圈机械角+余量再转回,只在0到一圈之间采样
+ */
+bool EncoderLinearCaliStart(EncoderLinearCali *elc,uint32_t svpwmid,MotorCfg *cfg)
+{
+	if(cfg == NULL || cfg->GetEncoderAddr == NULL || cfg->encodePPR < ENCODER_LINEAR_POINTS)
+	{
+		elc->Stage = EncoderLinearCaliStage_Fail;
+		return false;
+	}
+	memset(elc,0,sizeof(EncoderLinearCali));
+	elc->SvpwmId = svpwmid;
+	elc->Cfg = cfg;
+	elc->Span = (int32_t)cfg->pole * SvpwmDriverRad;
+	elc->Vector = -ENCODER_LINEAR_CALI_SETTLE * ENCODER_LINEAR_CALI_SPEED;
+	elc->Stage = EncoderLinearCaliStage_Align;
+	svpwmDri.setUse(svpwmid);
+	return true;
+}
+
+/*
+ *	参考位置 = 矢量*PPR/(pole*4096),偏差为参考减读数,1/16计数
+ *	相对第一次读数展开到+-半圈,超过半个电周期认为失步
+ */
+static bool EncoderLinearCaliSample(EncoderLinearCali *elc)
+{
+	const MotorCfg *cfg = elc->Cfg;
+	int32_t full = (int32_t)cfg->encodePPR<<ENCODER_LINEAR_FRAC;
+	uint16_t pos = *cfg->GetEncoderAddr;
+	int32_t ref = ((int64_t)elc->Vector * full) / elc->Span;
+	int32_t err = ((ref - ((int32_t)pos<<ENCODER_LINEAR_FRAC)) % full + full) % full;
+	uint32_t x = pos * ((((uint32_t)ENCODER_LINEAR_POINTS<<16)) / cfg->encodePPR);
+	uint32_t seg = x>>16;
+	float frac = (x & 0xFFFF) * (1.0f/65536);
+
+	if(elc->Samples++ == 0)
+		elc->ErrFirst = err;
+	err -= elc->ErrFirst;
+	if(err > full/2)
+		err -= full;
+	else if(err < -full/2)
+		err += full;
+	if(abs(err) > full / cfg->pole / 2)
+		return false;
+	elc->Sum[seg] += (1 - frac) * err;
+	elc->Weight[seg] += 1 - frac;
+	seg = (seg + 1) % ENCODER_LINEAR_POINTS;
+	elc->Sum[seg] += frac * err;
+	elc->Weight[seg] += frac;
+	return true;
+}
+
+//每点取加权平均,去掉均值
+static bool EncoderLinearCaliResult(EncoderLinearCali *elc)
+{
+	float c[ENCODER_LINEAR_POINTS];
+	float mean = 0;
+
+	for(uint8_t i = 0;i<ENCODER_LINEAR_POINTS;i++)
+	{
+		if(elc->Weight[i] < 1)
+			return false;
+		c[i] = elc->Sum[i] / elc->Weight[i];
+		mean += c[i];
+	}
+	mean /= ENCODER_LINEAR_POINTS;
+	elc->Peak = 0;
+	for(uint8_t i = 0;i<ENCODER_LINEAR_POINTS;i++)
+	{
+		float v = c[i] - mean;
+		Constrain(v,-INT16_MAX,INT16_MAX);
+		elc->Correct[i] = (int16_t)lroundf(v);
+		if(abs(elc->Correct[i]) > elc->Peak)
+			elc->Peak = abs(elc->Correct[i]);
+	}
+	return true;
+}
+
+/*
+ *	任务里每tick调用一次,返回当前阶段
+ *	完成后校正表已装入驱动,存flash由调用者决定
+ */
+uint8_t EncoderLinearCaliStep(EncoderLinearCali *elc)
+{
+	int32_t margin = ENCODER_LINEAR_CALI_SETTLE * ENCODER_LINEAR_CALI_SPEED;
+
+	switch(elc->Stage)
+	{
+		case EncoderLinearCaliStage_Align:
+			if(++elc->Tick >= ENCODER_LINEAR_CALI_ALIGN)
+				elc->Stage = EncoderLinearCaliStage_Forward;
+			break;
+		case EncoderLinearCaliStage_Forward:
+		case EncoderLinearCaliStage_Backward:
+			if(elc->Vector >= 0 && elc->Vector < elc->Span && !EncoderLinearCaliSample(elc))
+			{
+				EncoderLinearCaliFinish(elc,EncoderLinearCaliStage_Fail);
+				return elc->Stage;
+			}
+			if(elc->Stage == EncoderLinearCaliStage_Forward)
+			{
+				elc->Vector += ENCODER_LINEAR_CALI_SPEED;
+				if(elc->Vector >= elc->Span + margin)
+					elc->Stage = EncoderLinearCaliStage_Backward;
+			}else
+			{
+				elc->Vector -= ENCODER_LINEAR_CALI_SPEED;
+				if(elc->Vector < -margin)
+				{
+					bool ok = EncoderLinearCaliResult(elc);
+					if(ok)
+						svpwmDri.SetEncoderLinear(elc->SvpwmId,elc->Correct);
+					EncoderLinearCaliFinish(elc,ok ? EncoderLinearCaliStage_Done : EncoderLinearCaliStage_Fail);
+					return elc->Stage;
+				}
+			}
+			break;
+		default:
+			return elc->Stage;
+	}
+	svpwmDri.outPut(elc->SvpwmId,ENCODER_LINEAR_CALI_OUT,0,elc->Vector & SvpwmDriverRad_mask,false);
+	return elc->Stage;
+}
@@ -0,0 +1,70 @@
+/*
+ * encoderlinear.h
+ *
+ *  编码器非线性校正表,每圈ENCODER_LINEAR_POINTS点线性插值,开环拖动学习
+ */
+
+#ifndef __ENCODERLINEAR_H_
+#define __ENCODERLINEAR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "motorConfig.h"
+
+#define ENCODER_LINEAR_POINTS		56			//每圈校正点数,driver_stm32.h按56点预留
+#define ENCODER_LINEAR_FRAC			4			//校正量的小数位,1/16计数
+#define ENCODER_LINEAR_AXIS_NUM		3
+#define ENCODER_LINEAR_MAGIC		(((uint32_t)'E'<<24)|((uint32_t)'N'<<16)|((uint32_t)'L'<<8)|(uint32_t)'C')
+
+#define ENCODER_LINEAR_CALI_OUT		0.3f		//拖动矢量幅值 0-1
+#define ENCODER_LINEAR_CALI_SPEED	32			//矢量每tick转过的电角度 0-4096
+#define ENCODER_LINEAR_CALI_ALIGN	50			//开始前对齐的tick数
+#define ENCODER_LINEAR_CALI_SETTLE	10			//起步和换向后不采样的tick数
+
+typedef struct{
+	int16_t		Correct[ENCODER_LINEAR_POINTS + 1];		//最后一点重复第一点,插值不用回绕
+	uint32_t	PosToSeg_Q16;							//计数到校正段,Q16
+}EncoderLinear;
+
+typedef struct{
+	int16_t		Correct[ENCODER_LINEAR_AXIS_NUM][ENCODER_LINEAR_POINTS];
+	uint32_t	Magic;
+	uint32_t	CheckSum;				//CalculateCheckSum,不含自身
+}EncoderLinearRecord;
+
+typedef enum{
+	EncoderLinearCaliStage_Idle = 0,
+	EncoderLinearCaliStage_Align,
+	EncoderLinearCaliStage_Forward,
+	EncoderLinearCaliStage_Backward,
+	EncoderLinearCaliStage_Done,
+	EncoderLinearCaliStage_Fail,
+}EncoderLinearCaliStage;
+
+typedef struct{
+	uint32_t	SvpwmId;
+	MotorCfg	*Cfg;
+	uint8_t		Stage;
+	uint16_t	Tick;
+	int32_t		Vector;			//输出矢量的电角度,不回绕
+	int32_t		Span;			//一圈机械角对应的电角度
+	int32_t		ErrFirst;		//第一次读数的偏差,其余相对它展开
+	uint32_t	Samples;
+	float		Sum[ENCODER_LINEAR_POINTS];
+	float		Weight[ENCODER_LINEAR_POINTS];
+	int16_t		Correct[ENCODER_LINEAR_POINTS];
+	int16_t		Peak;			//最大校正量,1/16计数
+}EncoderLinearCali;
+
+void EncoderLinearSetPPR(EncoderLinear *el,uint16_t encodePPR);
+void EncoderLinearSet(EncoderLinear *el,const int16_t *correct);
+int32_t EncoderLinearCorrect(const EncoderLinear *el,uint16_t pos);
+
+bool EncoderLinearLoad(int16_t *correct,uint8_t axis,uint32_t addr);
+void EncoderLinearStore(uint32_t addr,uint8_t axis,const int16_t *correct);
+void EncoderLinearClear(uint32_t addr);
+
+bool EncoderLinearCaliStart(EncoderLinearCali *elc,uint32_t svpwmid,MotorCfg *cfg);
+uint8_t EncoderLinearCaliStep(EncoderLinearCali *elc);
+
+#endif /* __ENCODERLINEAR_H_ */
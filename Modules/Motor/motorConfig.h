@@ -25,6 +25,8 @@ typedef void (*ReleaseSetFun)(uint32_t id);
 typedef void (*ReleaseUseFun)(uint32_t id);
 typedef bool (*ClaimUseFun)(uint32_t id,uint32_t claimUseTimeout_ms);
 typedef bool (*SetMotorConfigFun)(uint32_t svpwmid,uint32_t cfg);
+typedef void (*OutPutAlphaBetaFun)(uint32_t id,int32_t v_alpha_Q15,int32_t v_beta_Q15);
+typedef bool (*SetEncoderLinearFun)(uint32_t svpwmid,const int16_t *correct);
 
 typedef struct{
     OutPutFun               outPut;
@@ -32,6 +34,8 @@ typedef struct{
     ReleaseUseFun           releaseUse;
     ClaimUseFun             claimUse;
     SetMotorConfigFun       SetMotorConfig;
+    OutPutAlphaBetaFun      outPutAlphaBeta;
+    SetEncoderLinearFun     SetEncoderLinear;
 }MotorDriver;
 
 #endif /* MOTORCONFIG_H_ */
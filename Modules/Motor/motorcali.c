@@ -0,0 +1,177 @@
+/*
+ * motorcali.c
+ *
+ *  编码器零位校准,任务tick里步进
+ */
+#include "motorcali.h"
+#include <stddef.h>
+#include <string.h>
+#include "motordriver.h"
+#include "svpwm.h"
+#include "myMath.h"
+
+static uint32_t MotorZeroPosCheckSum(const MotorZeroPosRecord *rec)
+{
+	return CalculateCheckSum((unsigned char *)rec,offsetof(MotorZeroPosRecord,CheckSum));
+}
+
+/*
+ *	addr为标定数据RAM映像里的记录地址,magic或校验不对时不改cfg
+ */
+bool MotorZeroPosLoad(MotorCfg *cfg,uint8_t axis,uint32_t addr)
+{
+	MotorZeroPosRecord rec;
+
+	DEBUG_Assert(axis < MOTOR_ZERO_POS_AXIS_NUM);
+	memcpy(&rec,(const void *)addr,sizeof(rec));
+	if(rec.Magic != MOTOR_ZERO_POS_MAGIC || rec.CheckSum != MotorZeroPosCheckSum(&rec))
+		return false;
+	if(rec.ZeroPos[axis] >= cfg->encodePPR)
+		return false;
+	cfg->encodeZeroPos = rec.ZeroPos[axis];
+	return true;
+}
+
+//只改一个轴,其他轴保留;记录无效时其他轴清零
+void MotorZeroPosStore(uint32_t addr,uint8_t axis,uint16_t zeroPos)
+{
+	MotorZeroPosRecord rec;
+
+	DEBUG_Assert(axis < MOTOR_ZERO_POS_AXIS_NUM);
+	memcpy(&rec,(const void *)addr,sizeof(rec));
+	if(rec.Magic != MOTOR_ZERO_POS_MAGIC || rec.CheckSum != MotorZeroPosCheckSum(&rec))
+		memset(&rec,0,sizeof(rec));
+	rec.Magic = MOTOR_ZERO_POS_MAGIC;
+	rec.ZeroPos[axis] = zeroPos;
+	rec.CheckSum = MotorZeroPosCheckSum(&rec);
+	memcpy((void *)addr,&rec,sizeof(rec));
+}
+
+void MotorZeroPosClear(uint32_t addr)
+{
+	memset((void *)addr,0xFF,sizeof(MotorZeroPosRecord));
+}
+
+//编码器读数对应的电角度,0-4096
+static int32_t MotorZeroCaliEncoderVector(const MotorCfg *cfg)
+{
+	uint32_t pos = *cfg->GetEncoderAddr;
+	return (((uint64_t)pos * cfg->pole * SvpwmDriverRad + (cfg->encodePPR>>1)) / cfg->encodePPR) & SvpwmDriverRad_mask;
+}
+
+static void MotorZeroCaliFinish(MotorZeroCali *mzc,uint8_t stage)
+{
+	svpwmDri.outPut(mzc->SvpwmId,0,0,0,false);
+	svpwmDri.releaseUse(mzc->SvpwmId);
+	mzc->Stage = stage;
+}
+
+/*
+ *	turns为正反各转过的电周期数,取极对数即转一整圈机械角
+ *	占用svpwm驱动,电流环在标定期间不输出
+ */
+bool MotorZeroCaliStart(MotorZeroCali *mzc,uint32_t svpwmid,MotorCfg *cfg,uint16_t turns)
+{
+	if(cfg == NULL || cfg->GetEncoderAddr == NULL || turns == 0)
+	{
+		mzc->Stage = MotorZeroCaliStage_Fail;
+		return false;
+	}
+	memset(mzc,0,sizeof(MotorZeroCali));
+	mzc->SvpwmId = svpwmid;
+	mzc->Cfg = cfg;
+	mzc->Points = turns * MOTOR_ZERO_CALI_POINTS;
+	mzc->Stage = MotorZeroCaliStage_Align;
+	svpwmDri.setUse(svpwmid);
+	return true;
+}
+
+/*
+ *	到点稳定后累计矢量与编码器电角度之差,相对第一次读数展开到+-半圈
+ */
+static bool MotorZeroCaliSample(MotorZeroCali *mzc,uint8_t dir)
+{
+	int32_t err = (mzc->Vector - MotorZeroCaliEncoderVector(mzc->Cfg)) & SvpwmDriverRad_mask;
+
+	if(mzc->ErrNum[0] == 0 && mzc->ErrNum[1] == 0)
+		mzc->ErrFirst = err;
+	err = ((err - mzc->ErrFirst + SvpwmDriverRad_half) & SvpwmDriverRad_mask) - SvpwmDriverRad_half;
+	if(err > MOTOR_ZERO_CALI_SPREAD_MAX || err < -MOTOR_ZERO_CALI_SPREAD_MAX)
+		return false;
+	mzc->ErrSum[dir] += err;
+	mzc->ErrNum[dir]++;
+	return true;
+}
+
+static void MotorZeroCaliResult(MotorZeroCali *mzc)
+{
+	const MotorCfg *cfg = mzc->Cfg;
+	int32_t fwd = mzc->ErrSum[0] / (int32_t)mzc->ErrNum[0];
+	int32_t bwd = mzc->ErrSum[1] / (int32_t)mzc->ErrNum[1];
+	uint32_t offset = (mzc->ErrFirst + (fwd + bwd) / 2) & SvpwmDriverRad_mask;
+
+	mzc->Hysteresis = fwd - bwd;
+	//(pos + zero)*pole/PPR = 编码器电角度 + offset
+	mzc->ZeroPos = ((uint64_t)offset * cfg->encodePPR + (cfg->pole * SvpwmDriverRad >> 1)) / ((uint32_t)cfg->pole * SvpwmDriverRad);
+	mzc->Cfg->encodeZeroPos = mzc->ZeroPos;
+}
+
+/*
+ *	任务里每tick调用一次,返回当前阶段
+ */
+uint8_t MotorZeroCaliStep(MotorZeroCali *mzc)
+{
+	uint8_t dir = mzc->Stage == MotorZeroCaliStage_Backward;
+	int32_t step = dir ? -(SvpwmDriverRad / MOTOR_ZERO_CALI_POINTS) : SvpwmDriverRad / MOTOR_ZERO_CALI_POINTS;
+
+	switch(mzc->Stage)
+	{
+		case MotorZeroCaliStage_Align:
+			if(++mzc->Tick >= MOTOR_ZERO_CALI_ALIGN)
+			{
+				mzc->Tick = 0;
+				mzc->Target = mzc->Vector + step;
+				mzc->Stage = MotorZeroCaliStage_Forward;
+			}
+			break;
+		case MotorZeroCaliStage_Forward:
+		case MotorZeroCaliStage_Backward:
+			if(mzc->Vector != mzc->Target)
+			{
+				int32_t d = mzc->Target - mzc->Vector;
+				Constrain(d,-MOTOR_ZERO_CALI_SPEED,MOTOR_ZERO_CALI_SPEED);
+				mzc->Vector += d;
+				break;
+			}
+			if(++mzc->Tick <= MOTOR_ZERO_CALI_SETTLE)
+				break;
+			if(!MotorZeroCaliSample(mzc,dir))
+			{
+				MotorZeroCaliFinish(mzc,MotorZeroCaliStage_Fail);
+				return mzc->Stage;
+			}
+			if(mzc->Tick < MOTOR_ZERO_CALI_SETTLE + MOTOR_ZERO_CALI_AVG)
+				break;
+			mzc->Tick = 0;
+			if(++mzc->Point < mzc->Points)
+			{
+				mzc->Target += step;
+			}else if(!dir)
+			{
+				//反向从最后一点退一步开始,采同样点数回到对齐位置
+				mzc->Point = 0;
+				mzc->Stage = MotorZeroCaliStage_Backward;
+				mzc->Target -= step;
+			}else
+			{
+				MotorZeroCaliResult(mzc);
+				MotorZeroCaliFinish(mzc,MotorZeroCaliStage_Done);
+				return mzc->Stage;
+			}
+			break;
+		default:
+			return mzc->Stage;
+	}
+	svpwmDri.outPut(mzc->SvpwmId,MOTOR_ZERO_CALI_OUT,0,mzc->Vector & SvpwmDriverRad_mask,false);
+	return mzc->Stage;
+}
@@ -0,0 +1,64 @@
+/*
+ * motorcali.h
+ *
+ *  编码器零位校准,开环矢量正反向步进取平均,结果存校准区
+ */
+
+#ifndef __MOTORCALI_H_
+#define __MOTORCALI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "motorConfig.h"
+
+#define MOTOR_ZERO_POS_MAGIC		(((uint32_t)'M'<<24)|((uint32_t)'Z'<<16)|((uint32_t)'P'<<8)|(uint32_t)'S')
+#define MOTOR_ZERO_POS_AXIS_NUM		3			//driver_stm32.h按三个轴预留
+
+#define MOTOR_ZERO_CALI_OUT			0.3f		//锁定矢量幅值 0-1
+#define MOTOR_ZERO_CALI_POINTS		8			//每个电周期的采样点
+#define MOTOR_ZERO_CALI_SPEED		64			//点之间矢量每tick转过的电角度 0-4096
+#define MOTOR_ZERO_CALI_ALIGN		50			//开始前在0角度对齐的tick数
+#define MOTOR_ZERO_CALI_SETTLE		5			//到点后等待的tick数
+#define MOTOR_ZERO_CALI_AVG			5			//每点读编码器的次数,每tick一次
+#define MOTOR_ZERO_CALI_SPREAD_MAX	512			//各点偏差离第一点超过该电角度认为失败(编码器反向/极对数不对/堵转)
+
+typedef struct{
+	uint16_t ZeroPos[MOTOR_ZERO_POS_AXIS_NUM];
+	uint16_t Reserved;
+	uint32_t Magic;
+	uint32_t CheckSum;			//CalculateCheckSum,不含自身
+}MotorZeroPosRecord;
+
+typedef enum{
+	MotorZeroCaliStage_Idle = 0,
+	MotorZeroCaliStage_Align,
+	MotorZeroCaliStage_Forward,
+	MotorZeroCaliStage_Backward,
+	MotorZeroCaliStage_Done,
+	MotorZeroCaliStage_Fail,
+}MotorZeroCaliStage;
+
+typedef struct{
+	uint32_t	SvpwmId;
+	MotorCfg	*Cfg;
+	uint8_t		Stage;
+	uint16_t	Points;			//每个方向的采样点数
+	uint16_t	Point;
+	uint16_t	Tick;
+	int32_t		Vector;			//输出矢量的电角度,不回绕
+	int32_t		Target;
+	int32_t		ErrFirst;		//第一次读数的偏差,其余相对它展开
+	int32_t		ErrSum[2];		//正反两个方向
+	uint32_t	ErrNum[2];
+	int32_t		Hysteresis;		//正反平均偏差之差,电角度
+	uint16_t	ZeroPos;
+}MotorZeroCali;
+
+bool MotorZeroPosLoad(MotorCfg *cfg,uint8_t axis,uint32_t addr);
+void MotorZeroPosStore(uint32_t addr,uint8_t axis,uint16_t zeroPos);
+void MotorZeroPosClear(uint32_t addr);
+
+bool MotorZeroCaliStart(MotorZeroCali *mzc,uint32_t svpwmid,MotorCfg *cfg,uint16_t turns);
+uint8_t MotorZeroCaliStep(MotorZeroCali *mzc);
+
+#endif /* __MOTORCALI_H_ */
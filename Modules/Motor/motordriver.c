@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include "myMath.h"
 #include "string.h"
+#include "fastmem.h"
 
 #define SVMPWMAGIC		(((uint32_t)'S'<<24)|(uint32_t)'p'<<16|(uint32_t)'w'<<8|(uint32_t)'m'<<24)
 
@@ -21,6 +22,8 @@ static void SvpwmDriverReleaseUse(uint32_t svpwmid);
 static void SvpwmOutSet(uint32_t svpwmid,float	out,uint16_t encoderPos,uint16_t vectorPos,bool isClosedLoop);
 static bool SvpwmDriverSetMotorConfig(uint32_t svpwmid,uint32_t cfg);
 static void SvpwmGenerate(uint32_t svpwmid,float dt);
+static void SvpwmOutSetAlphaBeta(uint32_t svpwmid,int32_t v_alpha_Q15,int32_t v_beta_Q15);
+static bool SvpwmDriverSetEncoderLinear(uint32_t svpwmid,const int16_t *correct);
 
 const MotorDriver svpwmDri = {
 	.outPut = SvpwmOutSet,
@@ -28,6 +31,8 @@ const MotorDriver svpwmDri = {
 	.releaseUse = SvpwmDriverReleaseUse,
 	.claimUse = SvpwmDriverClaimUse,
 	.SetMotorConfig	= SvpwmDriverSetMotorConfig,
+	.outPutAlphaBeta = SvpwmOutSetAlphaBeta,
+	.SetEncoderLinear = SvpwmDriverSetEncoderLinear,
 };
 
 static bool SvpwmValidate(SvpwmDrive	*svpwmDri)
@@ -77,11 +82,33 @@ static bool SvpwmDriverSetMotorConfig(uint32_t svpwmid,uint32_t cfg)
 		return false;
 
 	svpwmDrive->cfg = (MotorCfg *)cfg;
+	svpwmDrive->periodMax_DIV_SQRT3 = ((uint32_t)svpwmDrive->cfg->PhasePulseMax*INV_SQRT3_Q15)>>15;
+	svpwmDrive->periodMax_div2 = svpwmDrive->cfg->PhasePulseMax>>1;
+	/*
+	 *	电角度 = 计数*pole/encodePPR 圈,按2^32/圈定点,乘法溢出即对整圈取模
+	 *	encodePPR不必是pole的整数倍
+	 */
+	DEBUG_Assert(svpwmDrive->cfg->encodePPR > svpwmDrive->cfg->pole);
+	svpwmDrive->encodeToVector_Q32 = (((uint64_t)svpwmDrive->cfg->pole<<32) + (svpwmDrive->cfg->encodePPR>>1))/svpwmDrive->cfg->encodePPR;
+	EncoderLinearSetPPR(&svpwmDrive->linear,svpwmDrive->cfg->encodePPR);
 
 	return true;
 }
 
-static bool SvpwmDriverClaimUse(uint32_t svpwmid,uint32_t claimUseTimeout_ms)
+/*
+ *	correct为ENCODER_LINEAR_POINTS个校正量,NULL时去掉校正
+ */
+static bool SvpwmDriverSetEncoderLinear(uint32_t svpwmid,const int16_t *correct)
+{
+	SvpwmDrive	*svpwmDrive = (SvpwmDrive *)svpwmid;
+	if(!SvpwmValidate(svpwmDrive))
+		return false;
+
+	EncoderLinearSet(&svpwmDrive->linear,correct);
+	return true;
+}
+
+FAST_CODE static bool SvpwmDriverClaimUse(uint32_t svpwmid,uint32_t claimUseTimeout_ms)
 {
 	SvpwmDrive	*svpwmDrive = (SvpwmDrive *)svpwmid;
 	if(!SvpwmValidate(svpwmDrive))
@@ -112,7 +139,7 @@ static void SvpwmDriverReleaseUse(uint32_t svpwmid)
 #endif
 }
 
-static void SvpwmOutSet(uint32_t svpwmid,float	out,uint16_t encoderPos,uint16_t vectorPos,bool isClosedLoop)
+FAST_CODE static void SvpwmOutSet(uint32_t svpwmid,float	out,uint16_t encoderPos,uint16_t vectorPos,bool isClosedLoop)
 {
 	SvpwmDrive	*svpwmDrive = (SvpwmDrive *)svpwmid;
 	float dt = 0;
@@ -134,7 +161,7 @@ static void SvpwmOutSet(uint32_t svpwmid,float	out,uint16_t encoderPos,uint16_t
     SvpwmGenerate(svpwmid,dt);
 }
 
-static void SvpwmGenerate(uint32_t svpwmid ,float dt)
+FAST_CODE static void SvpwmGenerate(uint32_t svpwmid ,float dt)
 {
 	SvpwmDrive	*svpwmDrive = (SvpwmDrive *)svpwmid;
 	DEBUG_Assert(svpwmDrive);
@@ -142,11 +169,13 @@ static void SvpwmGenerate(uint32_t svpwmid ,float dt)
 
 	if(svpwmDrive->isClosedLoop != false)
 	{
-		uint16_t encodePPRperPole = svpwmDrive->cfg->encodePPR/svpwmDrive->cfg->pole;
+		uint32_t pos = (uint32_t)svpwmDrive->encoderPos + svpwmDrive->cfg->encodeZeroPos;
+		//校正量按原始读数查表,1/16计数换成电角度,同样对整圈取模
+		uint32_t correct = EncoderLinearCorrect(&svpwmDrive->linear,svpwmDrive->encoderPos);
 
-		svpwmDrive->vectorPos = svpwmDrive->cfg->encodePPR + svpwmDrive->encoderPos + svpwmDrive->cfg->encodeZeroPos;
-		svpwmDrive->vectorPos =	svpwmDrive->vectorPos%(encodePPRperPole);
-		svpwmDrive->vectorPos = (uint64_t)SvpwmDriverRad * svpwmDrive->vectorPos/encodePPRperPole;
+		if(pos >= svpwmDrive->cfg->encodePPR)
+			pos -= svpwmDrive->cfg->encodePPR;
+		svpwmDrive->vectorPos = (pos * svpwmDrive->encodeToVector_Q32 + correct * (svpwmDrive->encodeToVector_Q32>>ENCODER_LINEAR_FRAC) + (1u<<19)) >> 20;
 		svpwmDrive->vectorPos += SIGN(svpwmDrive->out)*SvpwmDriverRad_Quart;
 		svpwmDrive->vectorPos = svpwmDrive->vectorPos&SvpwmDriverRad_mask;
 	}else
@@ -161,6 +190,24 @@ static void SvpwmGenerate(uint32_t svpwmid ,float dt)
 	}
 }
 
+/*
+ *	v_alpha_Q15,v_beta_Q15		VALUE_Q15 = Vdc/sqrt(3),svpwm2线性区最大矢量
+ *	电流按物理通道采样,电流环在同一坐标系,不做svpwmPhaseReverse
+ */
+FAST_CODE static void SvpwmOutSetAlphaBeta(uint32_t svpwmid,int32_t v_alpha_Q15,int32_t v_beta_Q15)
+{
+	SvpwmDrive	*svpwmDrive = (SvpwmDrive *)svpwmid;
+	uint16_t pulse[MotorPhase_Num];
+	if(!SvpwmValidate(svpwmDrive))
+		return;
 
+	if(svpwmDrive->cfg == NULL)
+		return;
 
-
+	svpwmDrive->isCurrentLoop = true;
+	svpwm2(v_alpha_Q15,v_beta_Q15,pulse,svpwmDrive->periodMax_DIV_SQRT3,svpwmDrive->periodMax_div2);
+	if(svpwmDrive->updataFun!=NULL)
+	{
+		svpwmDrive->updataFun(svpwmDrive->svpwm_tim_id,pulse);
+	}
+}
@@ -8,6 +8,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "board_hw_defs.h"
 #include "motorConfig.h"
+#include "encoderlinear.h"
 #include "tim_PWM_Output.h"
 
  typedef struct{
@@ -21,6 +22,10 @@
  	bool				isCurrentLoop;
 
  	MotorCfg	const 	*cfg;
+ 	uint16_t			periodMax_DIV_SQRT3;
+ 	uint16_t			periodMax_div2;
+ 	uint32_t			encodeToVector_Q32;		//每个编码器计数对应的电角度,2^32为一圈
+ 	EncoderLinear		linear;					//编码器非线性校正,未装入时全零
  	uint32_t			svpwm_tim_id;
  #if defined(PIOS_INCLUDE_FREERTOS)
  	struct pios_mutex	*svpwmUseMutex;
@@ -6,6 +6,9 @@
 #include "svpwm.h"
 #include "current.h"
 #include "adc.h"
+#include "motorcali.h"
+#include "encoderlinear.h"
+#include "califlash.h"
 /* Includes ------------------------------------------------------------------*/
 #include "FreeRTOS.h"
 #include "task.h"
@@ -18,6 +21,94 @@ static MotorCfg		motorCfg={
 	.isUplseReverse = MotorRotateReverse_ACB,//MOTOR_Y_ROTATE_REVERSE,
 };
 
+#define MOTOR_TEST_AXIS		0			//本电机在零位记录里的轴号
+
+static MotorZeroCali	motorZeroCali;
+static EncoderLinearCali	encoderLinearCali;
+static volatile uint8_t	motorTestRequest = MotorTestRequest_None;
+
+//其他任务调用,在MotoTestTask里执行
+void MotorTestRequestSet(uint8_t request)
+{
+	motorTestRequest = request;
+}
+
+/*
+ *	写flash期间中断停顿,先占用驱动输出零矢量
+ */
+static bool MotorTestCaliSave(void)
+{
+	bool ok;
+	svpwmDri.setUse(svpwmID);
+	svpwmDri.outPut(svpwmID,0.0,0,0,false);
+	ok = CaliFlashSave();
+	svpwmDri.releaseUse(svpwmID);
+	return ok;
+}
+
+static void MotorTestHandleRequest(void)
+{
+	uint8_t request = motorTestRequest;
+
+	motorTestRequest = MotorTestRequest_None;
+	switch(request)
+	{
+		case MotorTestRequest_ZeroCali:
+			//正反各转一整圈机械角
+			if(!MotorZeroCaliStart(&motorZeroCali,svpwmID,&motorCfg,motorCfg.pole))
+				printf("zero cali no encoder\n");
+			break;
+		case MotorTestRequest_ZeroClear:
+			MotorZeroPosClear(GetFlashMapAddr(FlashInterMotorZeroPosAddr));
+			motorCfg.encodeZeroPos = 0;
+			MotorTestCaliSave();
+			break;
+		case MotorTestRequest_LinearCali:
+			if(!EncoderLinearCaliStart(&encoderLinearCali,svpwmID,&motorCfg))
+				printf("linear cali no encoder\n");
+			break;
+		case MotorTestRequest_LinearClear:
+			EncoderLinearClear(GetFlashMapAddr(EncoderLinearCorrectAddr));
+			svpwmDri.SetEncoderLinear(svpwmID,NULL);
+			MotorTestCaliSave();
+			break;
+		default:break;
+	}
+}
+
+static void MotorTestZeroCali(void)
+{
+	switch(MotorZeroCaliStep(&motorZeroCali))
+	{
+		case MotorZeroCaliStage_Done:
+			MotorZeroPosStore(GetFlashMapAddr(FlashInterMotorZeroPosAddr),MOTOR_TEST_AXIS,motorZeroCali.ZeroPos);
+			printf("zero %u hys %d %s\n",motorZeroCali.ZeroPos,(int)motorZeroCali.Hysteresis,MotorTestCaliSave() ? "ok" : "flash err");
+			motorZeroCali.Stage = MotorZeroCaliStage_Idle;
+			break;
+		case MotorZeroCaliStage_Fail:
+			printf("zero cali fail\n");
+			motorZeroCali.Stage = MotorZeroCaliStage_Idle;
+			break;
+		default:break;
+	}
+}
+
+static void MotorTestLinearCali(void)
+{
+	switch(EncoderLinearCaliStep(&encoderLinearCali))
+	{
+		case EncoderLinearCaliStage_Done:
+			EncoderLinearStore(GetFlashMapAddr(EncoderLinearCorrectAddr),MOTOR_TEST_AXIS,encoderLinearCali.Correct);
+			printf("linear peak %d/16 %s\n",encoderLinearCali.Peak,MotorTestCaliSave() ? "ok" : "flash err");
+			encoderLinearCali.Stage = EncoderLinearCaliStage_Idle;
+			break;
+		case EncoderLinearCaliStage_Fail:
+			printf("linear cali fail\n");
+			encoderLinearCali.Stage = EncoderLinearCaliStage_Idle;
+			break;
+		default:break;
+	}
+}
 
 //Task任务
 void MotoTestTask(void const * argument)
@@ -25,8 +116,13 @@ void MotoTestTask(void const * argument)
   portTickType xLastWakeTime;
   uint64_t MotorPhase=0;
   svpwmArrayQ12Init();
-  SvpwmDriverPulseUpdateFunRegister(&svpwmID,Hal_Tim_pwmOut_ID,(uint32_t)MotorSvpwmTimPulseUpdate);
+  //零位在第一次输出PWM之前装入,没有有效记录时保持0
+  CaliFlashLoad();
+  MotorZeroPosLoad(&motorCfg,MOTOR_TEST_AXIS,GetFlashMapAddr(FlashInterMotorZeroPosAddr));
+  SvpwmDriverPulseUpdateFunRegister(&svpwmID,Hal_Tim_pwmOut_ID,(uint32_t)CurrentLoopPulseUpdate);
   svpwmDri.SetMotorConfig(svpwmID,(uint32_t)&motorCfg);
+  if(EncoderLinearLoad(encoderLinearCali.Correct,MOTOR_TEST_AXIS,GetFlashMapAddr(EncoderLinearCorrectAddr)))
+	  svpwmDri.SetEncoderLinear(svpwmID,encoderLinearCali.Correct);
   MotorInit();
   MotorSwitchOn();
   svpwmDri.outPut(svpwmID,0.0,0,0,false);
@@ -36,7 +132,9 @@ void MotoTestTask(void const * argument)
   while(1)
   {
 	vTaskDelayUntil(&xLastWakeTime,(10/portTICK_RATE_MS));
-
+	MotorTestHandleRequest();
+	MotorTestZeroCali();
+	MotorTestLinearCali();
   }
 }
 
@@ -3,6 +3,15 @@
 #include "stdbool.h"
 #include "board_hw_defs.h"
 
+typedef enum{
+	MotorTestRequest_None = 0,
+	MotorTestRequest_ZeroCali,		//编码器零位标定并写flash
+	MotorTestRequest_ZeroClear,		//清除flash里的零位记录
+	MotorTestRequest_LinearCali,	//编码器非线性学习并写flash
+	MotorTestRequest_LinearClear,	//清除flash里的非线性校正
+}MotorTestRequest;
+
+void MotorTestRequestSet(uint8_t request);
 
 #endif
 
@@ -6,12 +6,13 @@
  */
 #include "svpwm.h"
 #include "myMath.h"
+#include "fastmem.h"
 
 extern const float 			svpwmarray[2048];
 #define VALUE_Q12			4096
 #define VALUE_Q11			2048
 									//（svpwmarray[] - 2048） 相对中心点的偏离
-int16_t svpwmArrayQ12[4096];
+int16_t svpwmArrayQ12[4096] FAST_DATA;
 
 
 void svpwmArrayQ12Init(void)
@@ -29,7 +30,7 @@ void svpwmArrayQ12Init(void)
  *	uint16_t abs_out_Q12		0-4096	0-1
  *	uint16_t PeriodMax			定时器最大周期值
  */
-void svpwm(uint16_t vector_Q12,uint16_t *pulse,uint16_t abs_out_Q12,uint16_t PeriodMax)
+FAST_CODE void svpwm(uint16_t vector_Q12,uint16_t *pulse,uint16_t abs_out_Q12,uint16_t PeriodMax)
 {
 #if 0
 	/*940ns*/
@@ -66,7 +67,7 @@ void svpwm(uint16_t vector_Q12,uint16_t *pulse,uint16_t abs_out_Q12,uint16_t Per
 
 
 
-void svpwm2(int32_t v_alpha,int32_t v_beta,uint16_t *pulse,uint16_t periodMax_DIV_SQRT3,uint16_t periodMax_div2)
+FAST_CODE void svpwm2(int32_t v_alpha,int32_t v_beta,uint16_t *pulse,uint16_t periodMax_DIV_SQRT3,uint16_t periodMax_div2)
 {
 	//SQRT3_Q15
 	Q15 va,vb,vc,vmax,vmin,vcom;
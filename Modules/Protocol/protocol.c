@@ -9,8 +9,15 @@
 #include "pios_com.h"
 //#include "defaultCtrPara.h"
 #include <string.h>
+#include "current.h"
+#include "startup.h"
+#include "hfi.h"
+#include "motion.h"
 #include "myMath.h"
 #include "timer.h"
+#include "isrprofile.h"
+#include "motortest.h"
+#include "serialplot.h"
 /* Includes ------------------------------------------------------------------*/
 #include "FreeRTOS.h"
 #include "task.h"
@@ -26,6 +33,7 @@ TrigCountUnion      gbSendTrig = {
     .trigS = {
         .heartBeat      = 1000, 
         .Console        = 10,
+        .IsrProfile     = 50,
     },
 };
 
@@ -141,6 +149,22 @@ void HandleGBCtrCmd(uint8_t cmd)
 {
     switch(cmd)
     {
+        case CmdType_Cali_MZ:
+        {
+            MotorTestRequestSet(MotorTestRequest_ZeroCali);
+        }break;
+        case CmdType_Cali_MZ_Clear:
+        {
+            MotorTestRequestSet(MotorTestRequest_ZeroClear);
+        }break;
+        case CmdType_Cali_EL:
+        {
+            MotorTestRequestSet(MotorTestRequest_LinearCali);
+        }break;
+        case CmdType_Cali_EL_Clear:
+        {
+            MotorTestRequestSet(MotorTestRequest_LinearClear);
+        }break;
         case CmdType_PrintVersion:
         {
 //            printf("--------------------\n");
@@ -149,6 +173,37 @@ void HandleGBCtrCmd(uint8_t cmd)
 //            printf("Git: 0x%X\nMaster\n",(int)GitVersion);  
 //            printf("--------------------\n");
         }break;
+        case CmdType_IsrProfileReset:
+        {
+            IsrProfileReset();
+        }break;
+        case CmdType_MotorIdent:
+        {
+            MotorIdentStart(&motor_ident);
+        }break;
+        case CmdType_DecoupleOn:
+        {
+            motor_foc.Decouple = true;
+        }break;
+        case CmdType_DecoupleOff:
+        {
+            motor_foc.Decouple = false;
+        }break;
+        case CmdType_SensorlessStart:
+        {
+            MotorStartupStart(&motor_startup);
+        }break;
+        case CmdType_HfiOn:
+        {
+            if(!HfiStart(&motor_hfi))
+                printf("hfi no saliency\n");
+        }break;
+        case CmdType_HfiOff:
+        {
+            //只退出HFI,编码器/启动等其他角度来源不动
+            if(motor_foc.ThetaSource == FocThetaSource_Hfi)
+                motor_foc.ThetaSource = FocThetaSource_Observer;
+        }break;
         case CmdType_SystemReset:
         {
 
@@ -157,6 +212,45 @@ void HandleGBCtrCmd(uint8_t cmd)
     }
 }
 
+//设置结果打印到控制台
+void HandleGBSetPara(uint16_t index,int32_t value)
+{
+    switch(index)
+    {
+        case ParaIndex_CurrentLoopBw:
+        {
+            printf("cur bw %d Hz\n",(int)CurrentLoopSetBandwidth(value));
+        }break;
+        case ParaIndex_StartupAcc:
+        {
+            if(value > 0)
+                motor_startup.Acc = value;
+            printf("start acc %d\n",(int)motor_startup.Acc);
+        }break;
+        case ParaIndex_HfiVoltage:
+        {
+            printf("hfi %d mV\n",(int)(HfiSetVoltage(&motor_hfi,value*0.001f)*1000));
+        }break;
+        case ParaIndex_MotionSpeed:
+        {
+            MotionSpeed(&motor_motion,value*0.001f);
+        }break;
+        case ParaIndex_MotionPosition:
+        {
+            MotionMove(&motor_motion,value*0.001f);
+        }break;
+        case ParaIndex_MotionPosDiv:
+        {
+            printf("pos div %d\n",MotionSetPosDiv(&motor_motion,value));
+        }break;
+        case ParaIndex_MotionVelDiv:
+        {
+            printf("vel div %d\n",MotionSetVelDiv(&motor_motion,value));
+        }break;
+        default:break;
+    }
+}
+
 static void SendingBuffer(uint8_t * str,uint16_t len)
 {
     if(gbSendDelay)
@@ -219,6 +313,71 @@ void gbSendGroupConsole(uint32_t ExterBuffAddr)
 
 }
 
+//每次发一个阶段,轮流发送
+static void gbSendIsrProfile(void)
+{
+	static uint8_t stage = 0;
+	IsrProfileStage st;
+	uint32_t overrun;
+
+	if(!IsrProfileSnapshot((IsrStage)stage,&st,&overrun))
+	{
+		stage = (stage + 1) % IsrStage_Num;
+		return;
+	}
+	gbSend.isrProfile.headH = GT_PROTOCOL_HEAD_H;
+	gbSend.isrProfile.headL = GT_PROTOCOL_HEAD_L;
+	gbSend.isrProfile.type = FrameType_IsrProfile;
+	gbSend.isrProfile.profile.stage = stage;
+	gbSend.isrProfile.profile.count = st.Count;
+	gbSend.isrProfile.profile.overrun = overrun;
+	gbSend.isrProfile.profile.plotDrop = clPlotBuff.drop;
+	gbSend.isrProfile.profile.min = st.Min;
+	gbSend.isrProfile.profile.max = st.Max;
+	gbSend.isrProfile.profile.mean = (uint32_t)(st.Sum/st.Count);
+	memcpy(gbSend.isrProfile.profile.hist,st.Hist,sizeof(gbSend.isrProfile.profile.hist));
+	gbSend.isrProfile.checksum = CalculateCheckSum((uint8_t *)&gbSend,LengthOfFrame(FrameType_IsrProfile)-1);
+	SendingBuffer((uint8_t *)&gbSend,LengthOfFrame(FrameType_IsrProfile));
+	stage = (stage + 1) % IsrStage_Num;
+}
+
+//辨识结束时向控制台打印一次结果,单位mOhm/uH/uWb
+static void gbReportMotorIdent(void)
+{
+	static uint8_t lastStage = MotorIdentStage_Idle;
+	uint8_t stage = motor_ident.Stage;
+
+	if(stage == lastStage)
+		return;
+	lastStage = stage;
+	if(stage == MotorIdentStage_Done)
+	{
+		printf("Rs %d Ld %d\n",(int)(motor.Motor_Rs_pu*1000),(int)(motor.Motor_Ld_pu*1e6f));
+		printf("Lq %d psi %d\n",(int)(motor.Motor_Lq_pu*1e6f),(int)(motor.Motor_Flux*1e6f));
+	}else if(stage == MotorIdentStage_Fail)
+	{
+		printf("ident fail %d r %d\n",motor_ident.FailStage,(int)(motor_ident.Fit*1000));
+	}
+}
+
+//无感启动结束时打印一次,切到观测器的用时ms,失败时打印所在阶段
+static void gbReportStartup(void)
+{
+	static uint8_t lastStage = MotorStartupStage_Idle;
+	uint8_t stage = motor_startup.Stage;
+
+	if(stage == lastStage)
+		return;
+	lastStage = stage;
+	if(stage == MotorStartupStage_Done)
+	{
+		printf("start ok %d ms\n",(int)(motor_startup.CloseTicks*1000/PWM_FREQUENCE_VAL));
+	}else if(stage == MotorStartupStage_Fail)
+	{
+		printf("start fail %d\n",motor_startup.FailStage);
+	}
+}
+
 static void gbTxType(uint8_t type,uint16_t timeout)
 {
 	switch(type)
@@ -231,6 +390,10 @@ static void gbTxType(uint8_t type,uint16_t timeout)
 		{
 			gbSendGroupConsole(0);
 		}break;
+		case FrameType_IsrProfile:
+		{
+			gbSendIsrProfile();
+		}break;
 		default :break;
 	}
 }
@@ -249,6 +412,10 @@ static void gbRxHandle(void)
 		{
 		    HandleGBCtrCmd(gbRecv.cmd.cmd);
 		}break;
+		case FrameType_Set_Para:
+		{
+		    HandleGBSetPara(gbRecv.setPara.VarIndex,gbRecv.setPara.Value);
+		}break;
 		default:break;
 	}
 }
@@ -294,6 +461,8 @@ void ProtocolTask(void const * argument)
 	}
 
 	gbTxTrig(tick);
+	gbReportMotorIdent();
+	gbReportStartup();
 	if(gbSendDelay > 0)
 	    gbSendDelay--;
   }
@@ -43,6 +43,15 @@ typedef struct{
 	uint8_t checksum;
 }__attribute__((packed))FrameTypeCmd;
 /*-----------------------------------------------------------------------*/
+typedef struct{
+	uint8_t headL;
+	uint8_t headH;
+	uint8_t type;		//FrameType_Set_Para
+	uint16_t VarIndex;	//GBParaIndex
+	int32_t Value;
+	uint8_t checksum;
+}__attribute__((packed))FrameTypeSetPara;
+/*-----------------------------------------------------------------------*/
 typedef struct{
 	uint8_t headL;
 	uint8_t headH;
@@ -51,17 +60,34 @@ typedef struct{
 	uint8_t checksum;
 }__attribute__((packed))FrameTypeGroup_Console;
 
+/*-----------------------------------------------------------------------*/
+typedef struct{
+	uint8_t headL;
+	uint8_t headH;
+	uint8_t type;		//FrameType_IsrProfile
+	IsrProfileData profile;
+	uint8_t checksum;
+}__attribute__((packed))FrameTypeIsrProfile;
+
 /*-----------------------------------------------------------------------*/
 #define Length_FrameTypeHeartBeat			sizeof(FrameTypeHeartBeat)
 #define Length_FrameTypeGroup_Console		sizeof(FrameTypeGroup_Console)
+#define Length_FrameTypeIsrProfile			sizeof(FrameTypeIsrProfile)
+#define Length_FrameTypeCmd					sizeof(FrameTypeCmd)
+#define Length_FrameTypeSetPara				sizeof(FrameTypeSetPara)
 
 #define LengthOfFrame(protocoltype)			(	protocoltype ==	FrameType_HeartBeat					?	Length_FrameTypeHeartBeat			:\
-											(	protocoltype == FrameType_ObserveGroup_Console		?	Length_FrameTypeGroup_Console		:0))
+											(	protocoltype == FrameType_ObserveGroup_Console		?	Length_FrameTypeGroup_Console		:\
+											(	protocoltype == FrameType_IsrProfile				?	Length_FrameTypeIsrProfile			:\
+											(	protocoltype == FrameType_Cmd						?	Length_FrameTypeCmd					:\
+											(	protocoltype == FrameType_Set_Para					?	Length_FrameTypeSetPara				:0)))))
 
 typedef union{
 	FrameTypeHeartBeat				heartBeat;
 	FrameTypeCmd					cmd;
 	FrameTypeGroup_Console			console;
+	FrameTypeIsrProfile				isrProfile;
+	FrameTypeSetPara				setPara;
 }GBProtocol;
 /*-----------------------------------------------------------------------*/
 extern t_fifo_buffer 	gbConsoleBuffer;	
@@ -74,6 +100,7 @@ extern void gbProtocolHandle(const void * arg);
 typedef struct{
 	uint16_t heartBeat;
 	uint16_t Console;
+	uint16_t IsrProfile;
 }TrigFrameType;
 
 typedef union{
@@ -86,6 +113,7 @@ TrigCountUnion      gbSendTrig;
 extern uint8_t InfoOfTask;
 
 void HandleGBCtrCmd(uint8_t cmd);
+void HandleGBSetPara(uint16_t index,int32_t value);
 
 void gbSendGroupConsole(uint32_t ExterBuffAddr);
 #ifdef __cplusplus
@@ -4,6 +4,7 @@
 typedef enum{
     FrameType_HeartBeat = 0,
     FrameType_ObserveGroup_Console,
+    FrameType_IsrProfile,
     NumOfFrameType_Send,
     FrameType_Cmd = 50,
     FrameType_Cmd_Response = 51,
@@ -38,11 +39,29 @@ typedef enum{
     CmdType_EraseCtrPara = 16,
     CmdType_EraseStaticHis = 17,
     CmdType_ObserveEnable = 18,
+    CmdType_IsrProfileReset = 19,
+    CmdType_MotorIdent = 20,
+    CmdType_DecoupleOn = 21,
+    CmdType_DecoupleOff = 22,
+    CmdType_SensorlessStart = 23,
+    CmdType_HfiOn = 24,
+    CmdType_HfiOff = 25,
     
     CmdType_SystemReset = 50,
     CmdType_SystemReset_Hold_IN_Bootloader= 51,
 }GBCmdType;
 
+//FrameType_Set_Para的VarIndex
+typedef enum{
+    ParaIndex_CurrentLoopBw = 0,        //电流环带宽 Hz
+    ParaIndex_StartupAcc = 1,           //无感启动拖动加速度 电角速度 rad/s^2
+    ParaIndex_HfiVoltage = 2,           //高频注入幅值 mV
+    ParaIndex_MotionSpeed = 3,          //速度模式给定 机械角 mrad/s
+    ParaIndex_MotionPosition = 4,       //位置模式目标,相对原点 机械角 mrad
+    ParaIndex_MotionPosDiv = 5,         //位置环分频,PWM周期数
+    ParaIndex_MotionVelDiv = 6,         //速度环分频,PWM周期数
+}GBParaIndex;
+
 typedef struct{
     uint32_t second;
 }HeartBeat;
@@ -174,6 +193,17 @@ typedef struct{
     uint8_t dat[4];
 }CaliStatus;
 
+typedef struct{
+    uint8_t stage;          //IsrStage
+    uint32_t count;
+    uint32_t overrun;       //超出PWM周期的中断次数
+    uint32_t plotDrop;      //电流环波形环形缓冲满丢弃的帧数
+    uint32_t min;           //CPU周期
+    uint32_t max;
+    uint32_t mean;
+    uint32_t hist[16];      //第k格:[2^k,2^(k+1))周期
+}__attribute__((packed))IsrProfileData;
+
 typedef struct{
 	uint8_t axis;
 	int16_t index;
@@ -6,6 +6,12 @@
  */
 #include "serialplot.h"
 #include "pios_com.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fastmem.h"
+
+//单核M4上ISR与任务之间只需阻止编译器重排
+#define SERIALPLOT_BARRIER()	__asm volatile("" ::: "memory")
 
 //volatile SerialPlotFrame	frame[30] = {
 //		[0] = {
@@ -13,8 +19,8 @@
 //		.frameHeader2 = 0XBB,
 //		}
 //};
-CurrentLoopPlotBuff clPlotBuff = {
-		.mask = 63,
+CurrentLoopPlotBuff clPlotBuff FAST_DATA = {
+		.mask = SERIALPLOT_RING_LEN - 1,
 		.W = 0,
 		.R = 0,
 };
@@ -60,17 +66,68 @@ void SerialPlotFramePlotHalfWord2(int16_t fdata,int16_t fdata2)
     PIOS_COM_SendBufferNonBlocking(comDebugId,(uint8_t *)&frameHalfWord2,sizeof(SerialPlotFrame));
 }
 
+/*
+ * ISR调用,耗时恒定:写一帧后再发布W,满则丢弃计数
+ */
+FAST_CODE bool SerialPlotRingPush(float fdata0,float fdata1)
+{
+	uint32_t w = clPlotBuff.W;
+	SerialPlotFrameSingle *f;
 
+	if(w - clPlotBuff.R > clPlotBuff.mask)
+	{
+		clPlotBuff.drop++;
+		return false;
+	}
+	f = &clPlotBuff.frame[w & clPlotBuff.mask];
+	f->frameHeader1 = 0XAA;
+	f->frameHeader2 = 0XBB;
+	f->fdata[0] = fdata0;
+	f->fdata[1] = fdata1;
+	SERIALPLOT_BARRIER();
+	clPlotBuff.W = w + 1;
+	return true;
+}
 
+/*
+ * 任务调用:按连续段发送,串口fifo满时保留剩余帧下次再发
+ * 返回发出的帧数
+ */
+uint32_t SerialPlotRingDrain(void)
+{
+	uint32_t sent = 0;
 
+	while(1)
+	{
+		uint32_t r = clPlotBuff.R;
+		uint32_t n = clPlotBuff.W - r;
+		uint32_t idx = r & clPlotBuff.mask;
+
+		SERIALPLOT_BARRIER();
+		if(n == 0)
+			break;
+		if(n > SERIALPLOT_RING_LEN - idx)
+			n = SERIALPLOT_RING_LEN - idx;
+		if(n > SERIALPLOT_DRAIN_BURST)
+			n = SERIALPLOT_DRAIN_BURST;
+		if(PIOS_COM_SendBufferNonBlocking(comDebugId,(uint8_t *)&clPlotBuff.frame[idx],
+				(uint16_t)(n*sizeof(SerialPlotFrameSingle))) < 0)
+			break;
+		SERIALPLOT_BARRIER();
+		clPlotBuff.R = r + n;
+		sent += n;
+	}
+	return sent;
+}
 
+void SerialPlotTask(void const * argument)
+{
+	portTickType xLastWakeTime;
 
-
-
-
-
-
-
-
-
-
+	xLastWakeTime = xTaskGetTickCount();
+	while(1)
+	{
+		SerialPlotRingDrain();
+		vTaskDelayUntil(&xLastWakeTime,(SERIALPLOT_DRAIN_MS/portTICK_RATE_MS));
+	}
+}
@@ -12,6 +12,7 @@
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "global.h"
 #include "pios_com.h"
 
@@ -24,22 +25,34 @@ typedef  struct {
 	uint8_t 	checksum;
 }__attribute__((packed))SerialPlotFrame;
 
-typedef struct{
-	SerialPlotFrame frame[64];
-	uint8_t 	mask;
-	uint32_t 	W;
-	uint32_t 	R;
-}CurrentLoopPlotBuff;
-
 typedef struct{
 	uint8_t		frameHeader1;
 	uint8_t		frameHeader2;
 	float		fdata[2];
 }__attribute__((packed))SerialPlotFrameSingle;
 
+#define SERIALPLOT_RING_LEN		64			//2的幂
+#define SERIALPLOT_DRAIN_MS		1			//SerialPlotTask周期
+#define SERIALPLOT_DRAIN_BURST	(COM_USART_CONSOLE_TX_BUF_LEN/sizeof(SerialPlotFrameSingle))	//单次写入串口fifo的帧数
+
+/*
+ * 电流环ISR到SerialPlotTask的单生产者单消费者环形缓冲
+ * W只由ISR写,R只由任务写,不加锁;满时丢弃新帧并计数drop
+ */
+typedef struct{
+	SerialPlotFrameSingle frame[SERIALPLOT_RING_LEN];
+	uint32_t 	mask;
+	volatile uint32_t 	W;
+	volatile uint32_t 	R;
+	volatile uint32_t 	drop;
+}CurrentLoopPlotBuff;
+
 void SerialPlotFrameInput(float fdata[2]);
 
 void SerialPlotFramePlotHalfWord2(int16_t fdata,int16_t fdata2);
+bool SerialPlotRingPush(float fdata0,float fdata1);
+uint32_t SerialPlotRingDrain(void);
+void SerialPlotTask(void const * argument);
 extern CurrentLoopPlotBuff clPlotBuff;
 extern SerialPlotFrameSingle frame;
 extern SerialPlotFrame freamcrc;
@@ -8,23 +8,96 @@
 #include "tim_PWM_Output.h"
 #include "FreeRTOS.h"
 #include "current.h"
+#include "fastmem.h"
+#include "isrprofile.h"
 
 uint32_t hal_ADC_pwmout_sample_id;
 uint32_t hal_ADC_Vol_ID;
 
 uint32_t DMA2_Stream0_id;
 uint32_t DMA2_Stream1_id;
+uint32_t ADC_EOC_id;
 
 typedef struct{
 	GIMBAL_ADC_CFG *cfg;
 	uint32_t    FocDriverId;
 	struct pios_mutex	 *ADCBusyMutex;
-	uint16_t ADCSampleArr[3];
+	uint16_t ADCSampleArr[ADC_SAMPLE_NUM];
+	uint8_t ShuntSkip;				//SQR3当前配置下不采样的相
+	ADC_TypeDef *BusAdc;			//同一触发的母线电压ADC,NULL为没有
 	uint32_t adcMagic;
 }GimbalADCDev;
 
 #define ADC_MAGIC       0x02958abf
 
+//不采样的相 -> 主/从ADC采的相
+static const uint8_t ADCShuntPair[MotorPhase_Num][2] = {
+	[MotorPhase1] = {MotorPhase2,MotorPhase3},
+	[MotorPhase2] = {MotorPhase1,MotorPhase3},
+	[MotorPhase3] = {MotorPhase1,MotorPhase2},
+};
+
+/*
+ * 双ADC同步规则采样:主ADC转sConfig[0],从ADC转sConfig[1],
+ * 主ADC的外部触发同时启动两路,两相电流是同一时刻的值
+ * 三电阻时sConfig[2]是C相,采哪两相由ADCShuntSelect每周期切换
+ */
+static void ADCDualSimultInit(GimbalADCDev *dev)
+{
+	ADC_HandleTypeDef *slave = dev->cfg->hadcSlave;
+	ADC_ChannelConfTypeDef sConfig;
+	ADC_MultiModeTypeDef multimode = {
+		.Mode = ADC_DUALMODE_REGSIMULT,
+		.DMAAccessMode = ADC_DMAACCESSMODE_DISABLED,
+		.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_5CYCLES,
+	};
+
+	DEBUG_Assert(dev->cfg->channelNum >= 2);
+	HAL_RCC_CLK_ENABLE(slave->Instance);
+	if(HAL_ADC_Init(slave) != HAL_OK)
+	{
+		DEBUG_Assert(0);
+	}
+	for(uint8_t i= 0;i<dev->cfg->channelNum;i++)
+	{
+		HAL_RCC_CLK_ENABLE(dev->cfg->ADCGpio[i].gpio);
+		HAL_GPIO_Init(dev->cfg->ADCGpio[i].gpio,&dev->cfg->ADCGpio[i].initTypeDef);
+	}
+	sConfig = dev->cfg->sConfig[0];
+	sConfig.Rank = 1;
+	if(HAL_ADC_ConfigChannel(dev->cfg->hadc,&sConfig) != HAL_OK)
+	{
+		DEBUG_Assert(0);
+	}
+	sConfig = dev->cfg->sConfig[1];
+	sConfig.Rank = 1;
+	if(HAL_ADC_ConfigChannel(slave,&sConfig) != HAL_OK)
+	{
+		DEBUG_Assert(0);
+	}
+	if(HAL_ADCEx_MultiModeConfigChannel(dev->cfg->hadc,&multimode) != HAL_OK)
+	{
+		DEBUG_Assert(0);
+	}
+	__HAL_ADC_ENABLE(slave);
+	dev->ShuntSkip = MotorPhase3;
+}
+
+#if CURRENT_THREE_SHUNT
+/*
+ * 改下一次触发采样的两相,只有一个规则转换,改SQR3的SQ1即可
+ * 在EOC中断里调用,离下一次触发还有一个PWM周期
+ */
+FAST_CODE static void ADCShuntSelect(GimbalADCDev *dev,uint8_t skip)
+{
+	const uint8_t *pair = ADCShuntPair[skip];
+
+	dev->cfg->hadc->Instance->SQR3 = dev->cfg->sConfig[pair[0]].Channel;
+	dev->cfg->hadcSlave->Instance->SQR3 = dev->cfg->sConfig[pair[1]].Channel;
+	dev->ShuntSkip = skip;
+}
+#endif
+
 void ADCSampleInit(uint32_t *adc_id,const GIMBAL_ADC_CFG *cfg,bool isDmaUsed)
 {
     GimbalADCDev *dev = (GimbalADCDev *)pvPortMalloc(sizeof(GimbalADCDev));
@@ -34,6 +107,8 @@ void ADCSampleInit(uint32_t *adc_id,const GIMBAL_ADC_CFG *cfg,bool isDmaUsed)
 	dev->cfg = (GIMBAL_ADC_CFG *)cfg;
 
 	dev->adcMagic = ADC_MAGIC;
+	dev->BusAdc = NULL;
+	dev->ADCSampleArr[ADC_SAMPLE_VBUS] = ADC_VBUS_NONE;
 	
 	HAL_RCC_CLK_ENABLE(dev->cfg->hadc->Instance);
 	
@@ -42,18 +117,26 @@ void ADCSampleInit(uint32_t *adc_id,const GIMBAL_ADC_CFG *cfg,bool isDmaUsed)
 		DEBUG_Assert(0);
 	}
 
-	for(uint8_t i= 0;i<dev->cfg->channelNum;i++)
+	if(dev->cfg->hadcSlave != NULL)
 	{
-		HAL_RCC_CLK_ENABLE(dev->cfg->ADCGpio[i].gpio);
-		HAL_GPIO_Init(dev->cfg->ADCGpio[i].gpio,&dev->cfg->ADCGpio[i].initTypeDef);
-
-		if(HAL_ADC_ConfigChannel(dev->cfg->hadc,&dev->cfg->sConfig[i]) != HAL_OK )
+		ADCDualSimultInit(dev);
+	}else
+	{
+		for(uint8_t i= 0;i<dev->cfg->channelNum;i++)
 		{
-			DEBUG_Assert(0);
+			HAL_RCC_CLK_ENABLE(dev->cfg->ADCGpio[i].gpio);
+			HAL_GPIO_Init(dev->cfg->ADCGpio[i].gpio,&dev->cfg->ADCGpio[i].initTypeDef);
+
+			if(HAL_ADC_ConfigChannel(dev->cfg->hadc,&dev->cfg->sConfig[i]) != HAL_OK )
+			{
+				DEBUG_Assert(0);
+			}
 		}
 	}
 
-	if(dev->cfg->hdma->Instance == DMA2_Stream0)
+	if(dev->cfg->hdma == NULL)
+	{
+	}else if(dev->cfg->hdma->Instance == DMA2_Stream0)
 	{
 	    DMA2_Stream0_id = (uint32_t)dev;
 	}else if(dev->cfg->hdma->Instance == DMA2_Stream1)
@@ -63,6 +146,15 @@ void ADCSampleInit(uint32_t *adc_id,const GIMBAL_ADC_CFG *cfg,bool isDmaUsed)
 	
 	__HAL_ADC_ENABLE(dev->cfg->hadc);
 
+	if(dev->cfg->adcirq.irq_enabled)
+	{
+		STM32_IRQ_CFG *irq = &dev->cfg->adcirq;
+		ADC_EOC_id = (uint32_t)dev;
+		__HAL_ADC_ENABLE_IT(dev->cfg->hadc,ADC_IT_EOC);
+		HAL_NVIC_SetPriority(irq->irq_cfg.irq,irq->irq_cfg.nvic_preemptPriority,irq->irq_cfg.nvic_subPriority);
+		HAL_NVIC_EnableIRQ(irq->irq_cfg.irq);
+	}
+
 	if(isDmaUsed)
 	{
 		HAL_RCC_CLK_ENABLE(dev->cfg->hdma->Instance);
@@ -107,19 +199,25 @@ void SetDMAADC_INT_FOCProcessId(uint32_t adcId,uint32_t id)
     dev->FocDriverId = id;
 }
 
-void ADCSample(uint32_t adc_id,uint16_t sample[],uint8_t channelNum)
+/*
+ * 母线电压ADC与电流ADC同一个外部触发,转换时间相同
+ * 电流中断里顺便读它的DR,随相电流一起交给电流环
+ */
+void ADCBusVoltageLink(uint32_t adcId,uint32_t busAdcId)
 {
+	GimbalADCDev *dev = (GimbalADCDev *)adcId;
+	GimbalADCDev *bus = (GimbalADCDev *)busAdcId;
+	DEBUG_Assert(ADCValidate(dev));
+	DEBUG_Assert(ADCValidate(bus));
+	DEBUG_Assert(bus->cfg->hadc->Init.ExternalTrigConv == dev->cfg->hadc->Init.ExternalTrigConv);
+	dev->BusAdc = bus->cfg->hadc->Instance;
+}
 
-	GimbalADCDev *dev = (GimbalADCDev *)adc_id;
-	DEBUG_Assert(dev);  
-
-	for(uint8_t i = 0;i<dev->cfg->channelNum && i < channelNum;i++)
-	{
-		dev->cfg->hadc->Instance->SQR3 = dev->cfg->sConfig[i].Channel; 			 
-		dev->cfg->hadc->Instance->CR2	|= (uint32_t)(ADC_CR2_SWSTART ); 
-		while(!(dev->cfg->hadc->Instance->SR & ADC_FLAG_EOC)); 		 
-		sample[i] = (uint16_t)((dev->cfg->hadc->Instance->DR) & 0x0FFF);
-	}
+FAST_CODE static uint16_t ADCBusVoltageRead(GimbalADCDev *dev)
+{
+	if(dev->BusAdc == NULL || (dev->BusAdc->SR & ADC_SR_EOC) == RESET)
+		return ADC_VBUS_NONE;
+	return (uint16_t)dev->BusAdc->DR;
 }
 
 uint32_t GetAdcSampleResoltuion(uint32_t adc_id)
@@ -135,17 +233,46 @@ typedef struct
   __IO uint32_t Reserved0;
   __IO uint32_t IFCR;  /*!< DMA interrupt flag clear register */
 } DMA_Base_Registers;
-void DMA2_Stream0_IRQHandler(void)
+FAST_CODE void DMA2_Stream0_IRQHandler(void)
 {
 	GimbalADCDev *dev = (GimbalADCDev *)DMA2_Stream0_id;
 	DMA_Base_Registers *regs = (DMA_Base_Registers *)dev->cfg->hdma->StreamBaseAddress;
+	ISR_PROFILE_BEGIN();
 	if ((regs->ISR & (DMA_FLAG_TCIF0_4 << dev->cfg->hdma->StreamIndex)) != RESET)
 	{
 		if(__HAL_DMA_GET_IT_SOURCE(dev->cfg->hdma, DMA_IT_TC) != RESET)
 		{
 			/* Clear the transfer complete flag */
 			regs->IFCR = DMA_FLAG_TCIF0_4 << dev->cfg->hdma->StreamIndex;
+			dev->ADCSampleArr[ADC_SAMPLE_VBUS] = ADCBusVoltageRead(dev);
 			CurrentRunning(dev->FocDriverId,dev->ADCSampleArr);
 		}
 	}
 }
+
+/*
+ * 双ADC同步采样完成,读两个DR同时清掉两路EOC,直接进电流环
+ * 三电阻时按本次采的两相放进ADCSampleArr,电流环算完再换下一次的两相
+ */
+FAST_CODE void ADC_IRQHandler(void)
+{
+	GimbalADCDev *dev = (GimbalADCDev *)ADC_EOC_id;
+	ADC_TypeDef *master = dev->cfg->hadc->Instance;
+	ISR_PROFILE_BEGIN();
+	if((master->SR & ADC_SR_EOC) != RESET)
+	{
+		const uint8_t *pair = ADCShuntPair[dev->ShuntSkip];
+
+		dev->ADCSampleArr[dev->ShuntSkip] = ADC_SHUNT_SKIPPED;
+		dev->ADCSampleArr[pair[0]] = (uint16_t)master->DR;
+		dev->ADCSampleArr[pair[1]] = (uint16_t)dev->cfg->hadcSlave->Instance->DR;
+		dev->ADCSampleArr[ADC_SAMPLE_VBUS] = ADCBusVoltageRead(dev);
+		CurrentRunning(dev->FocDriverId,dev->ADCSampleArr);
+#if CURRENT_THREE_SHUNT
+		if(adc_result.shunt_next != dev->ShuntSkip)
+		{
+			ADCShuntSelect(dev,adc_result.shunt_next);
+		}
+#endif
+	}
+}
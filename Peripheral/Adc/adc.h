@@ -22,7 +22,7 @@ void ADCSampleInit(uint32_t *adcid,const GIMBAL_ADC_CFG *cfg,bool isDmaUsed);
 
 void SetDMAADC_INT_FOCProcessId(uint32_t adcId,uint32_t id);
 
-void ADCSample(uint32_t id,uint16_t sample[],uint8_t channelnum);
+void ADCBusVoltageLink(uint32_t adcId,uint32_t busAdcId);
 
 uint16_t ADCGetLastAndStartNewSample(uint32_t adcId,uint8_t channelNum);
 
@@ -7,11 +7,12 @@
 #include "tim_PWM_Output.h"
 #include "driver_stm32.h"
 #include "FreeRTOS.h"
-#include "current.h"
+#include "fastmem.h"
 
 uint32_t Hal_Tim_pwmOut_ID;
 
 uint32_t Hal_Tim_1,Hal_Tim_8;
+static volatile uint32_t *MotorSvpwmTimCcr(TIM_TypeDef *Timx,uint32_t timChan);
 //static void MotorSvpwmTimIRQEnable(uint32_t svpwm_tim_id,CurLoopConfig	*cfg);
 //static void MotorSvpwmCurrentLoopSetIq(uint32_t svpwm_tim_id,float iq,uint16_t encode,bool enable,float dt);
 //static uint32_t GetCurLoopHandle(uint32_t tim_id);
@@ -60,49 +61,64 @@ void MotorSvpwmTimInit(uint32_t *svpwm_tim_id,const GIMBAL_TIM_PWMOUT_CFG *cfg,u
 		}
 	}
 
+	pwmout_dev->Instance = pwmout_dev->MotorCfg->tim->Instance;
+	pwmout_dev->Period = pwmout_dev->MotorCfg->tim->Init.Period;
+	pwmout_dev->isPwm2 = (pwmout_dev->MotorCfg->oc.OCMode == TIM_OCMODE_PWM2);
+	for(uint8_t j = 0 ; j < MotorPhase_Num ; j++)
+	{
+		pwmout_dev->Ccr[j] = MotorSvpwmTimCcr(pwmout_dev->Instance,pwmout_dev->MotorCfg->TimChannel[j]);
+	}
+
 	pwmout_dev->IQRInited = false;
 	pwmout_dev->isInit = true;
 	*svpwm_tim_id = (uint32_t)pwmout_dev;
 }
 
-static void MotorSvpwmTimPulseSet(TIM_TypeDef *Timx,uint32_t timChan,uint16_t pulse)
+static volatile uint32_t *MotorSvpwmTimCcr(TIM_TypeDef *Timx,uint32_t timChan)
 {
 	switch(timChan)
 	{
-		case TIM_CHANNEL_1	:	Timx->CCR1 = pulse;	break;
-		case TIM_CHANNEL_2	:	Timx->CCR2 = pulse;	break;
-		case TIM_CHANNEL_3	:	Timx->CCR3 = pulse;	break;
-		case TIM_CHANNEL_4	:	Timx->CCR4 = pulse;	break;
-		default:break;
+		case TIM_CHANNEL_1	:	return &Timx->CCR1;
+		case TIM_CHANNEL_2	:	return &Timx->CCR2;
+		case TIM_CHANNEL_3	:	return &Timx->CCR3;
+		case TIM_CHANNEL_4	:	return &Timx->CCR4;
+		default:DEBUG_Assert(0);return NULL;
 	}
 }
 
-void MotorSvpwmTimPulseUpdate(uint32_t svpwm_tim_id,uint16_t *pulse)
+/*
+ * 比较寄存器开了预装载,三相在同一个更新事件生效;
+ * 写的过程中置UDIS,避免更新事件落在三次写之间只锁存一部分,
+ * 被挡掉的更新推迟半个周期,锁存的仍是同一组占空比.TRGO取OC1REF,ADC触发不受影响
+ * PWM2模式下pulse原地改成实际写入的CCR
+ */
+FAST_CODE void MotorSvpwmTimPulseUpdate(uint32_t svpwm_tim_id,uint16_t *pulse)
 {
 	GIMBAL_TIM_PWUOUT_DEV *pwmout_dev = (GIMBAL_TIM_PWUOUT_DEV *)svpwm_tim_id;
+	TIM_TypeDef *tim;
 	DEBUG_Assert(pwmout_dev);
 
-	for(uint8_t j = 0;j<MotorPhase_Num;j++)
+	if(pwmout_dev->isPwm2)
 	{
-	    if(pwmout_dev->MotorCfg->oc.OCMode == TIM_OCMODE_PWM2)
-	    {
-	        if(pulse[j] < pwmout_dev->MotorCfg->tim->Init.Period)
-	        {
-	            pulse[j] = pwmout_dev->MotorCfg->tim->Init.Period - pulse[j];
-	        }else
-	        {
-	            pulse[j] = 0;
-	        }
-	        
-	    }
-		MotorSvpwmTimPulseSet(pwmout_dev->MotorCfg->tim->Instance,pwmout_dev->MotorCfg->TimChannel[j],pulse[j]);
+		for(uint8_t j = 0;j<MotorPhase_Num;j++)
+		{
+			pulse[j] = pulse[j] < pwmout_dev->Period ? pwmout_dev->Period - pulse[j] : 0;
+		}
 	}
-	motor_Estimate.Ua_pu = (1050 - pulse[0])*12.0f/1050;
-	motor_Estimate.Ub_pu = (1050 - pulse[1])*12.0f/1050;
-	motor_Estimate.Uc_pu = (1050 - pulse[2])*12.0f/1050;
+	tim = pwmout_dev->Instance;
+	tim->CR1 |= TIM_CR1_UDIS;
+	*pwmout_dev->Ccr[MotorPhase1] = pulse[MotorPhase1];
+	*pwmout_dev->Ccr[MotorPhase2] = pulse[MotorPhase2];
+	*pwmout_dev->Ccr[MotorPhase3] = pulse[MotorPhase3];
+	tim->CR1 &= ~TIM_CR1_UDIS;
+}
+
+uint16_t MotorSvpwmTimPeriod(uint32_t svpwm_tim_id)
+{
+	GIMBAL_TIM_PWUOUT_DEV *pwmout_dev = (GIMBAL_TIM_PWUOUT_DEV *)svpwm_tim_id;
+	DEBUG_Assert(pwmout_dev);
 
-	motor_Estimate.Uan_pu = (motor_Estimate.Ua_pu * 2 - motor_Estimate.Ub_pu - motor_Estimate.Uc_pu)/3.0f;
-	motor_Estimate.Ubn_pu = (motor_Estimate.Ub_pu * 2 - motor_Estimate.Ua_pu - motor_Estimate.Uc_pu)/3.0f;
+	return pwmout_dev->Period;
 }
 
 
@@ -20,6 +20,10 @@ typedef struct{
 	GIMBAL_TIM_PWMOUT_CFG	*MotorCfg;
 	uint32_t CurrentLoopId;
 	uint32_t sampleADC_ID;
+	TIM_TypeDef *Instance;
+	volatile uint32_t *Ccr[MotorPhase_Num];		//三相比较寄存器,初始化时按TimChannel算好
+	uint16_t Period;
+	bool	isPwm2;
 	uint8_t SampleChannel;
 	bool	IQRInited;
 	bool    isInit;
@@ -32,6 +36,7 @@ void MotorSvpwmTimInit(uint32_t *svpwm_tim_id,const GIMBAL_TIM_PWMOUT_CFG *cfg,u
 
 
 void MotorSvpwmTimPulseUpdate(uint32_t svpwm_tim_id ,uint16_t *pulse);
+uint16_t MotorSvpwmTimPeriod(uint32_t svpwm_tim_id);
 uint16_t CurLoopADCSampleChannal(uint32_t svpwm_tim_id,uint8_t chan);
 
 extern uint32_t Hal_Tim_1,Hal_Tim_8;
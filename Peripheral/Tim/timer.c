@@ -8,11 +8,15 @@
 #include "driver_stm32.h"
 #include "stdlib.h"
 
-uint32_t Hal_Timer_ID;
 uint32_t Hal_Print_Tim_ID,Hal_motor_Tim_ID,Hal_can_Tim_ID;
 
 uint32_t Hal_Timer_4,Hal_Timer_5,Hal_Timer_6,Hal_Timer_7;
-volatile uint32_t glo_50ms=0;
+
+/*
+ * 时基:32位定时器1MHz自由计数,溢出中断把高32位加一
+ */
+static TIM_TypeDef *timebaseTim;
+static volatile uint32_t timebaseHigh;
 
 void SysTimerTimInit(uint32_t *timer_tim_id,const GIMBAL_TIM_TIMER_CFG *cfg)
 {
@@ -95,62 +99,102 @@ void TIM4_IRQHandler(void)
 	}
 }
 /**********************************************************************************/
-//定时器5中断
+//定时器5中断,时基溢出
 /**********************************************************************************/
 void TIM5_IRQHandler(void)
 {
-	GIMBAL_TIM_TIMER_DEV *timer_dev = (GIMBAL_TIM_TIMER_DEV	*)Hal_can_Tim_ID;
-	DEBUG_Assert(timer_dev);
-
-	if((timer_dev->TimerCfg->tim->Instance->DIER & TIM_IT_UPDATE) == TIM_IT_UPDATE)
+	if((TIM5->SR & TIM_SR_UIF) != 0)
 	{
-		timer_dev->TimerCfg->tim->Instance->SR &= ~TIM_IT_UPDATE;
-
+		TIM5->SR = ~TIM_SR_UIF;
+		timebaseHigh++;
 	}
 }
-	
-/**********************************************************************************/
-//定时器7中断
-/**********************************************************************************/
-void TIM7_IRQHandler(void)
+
+/*
+ * 溢出只在TIM5_IRQHandler里处理,只能用TIM5
+ * HAL_TIM_Base_Init的UG会置UIF,开中断前清掉,否则一上电高位就是1
+ */
+void TimebaseInit(const GIMBAL_TIM_TIMER_CFG *cfg)
 {
-	GIMBAL_TIM_TIMER_DEV *timer_dev = (GIMBAL_TIM_TIMER_DEV	*)Hal_Timer_ID;
+	GIMBAL_TIM_TIMER_DEV *timer_dev = malloc(sizeof(GIMBAL_TIM_TIMER_DEV));
+	const STM32_IRQ_CFG *irq = &cfg->tim_irq;
+
 	DEBUG_Assert(timer_dev);
+	DEBUG_Assert(cfg->tim->Instance == TIM5);
+	DEBUG_Assert(cfg->tim->Init.Period == 0xFFFFFFFF);
+	DEBUG_Assert(irq->irq_enabled);
+	timer_dev->TimerCfg = (GIMBAL_TIM_TIMER_CFG	*)cfg;
+	timebaseHigh = 0;
+	timebaseTim = cfg->tim->Instance;
 
-	if((timer_dev->TimerCfg->tim->Instance->DIER & TIM_IT_UPDATE) == TIM_IT_UPDATE)
+	HAL_RCC_CLK_ENABLE(timebaseTim);
+	HAL_TIM_Base_DeInit(cfg->tim);
+	if(HAL_TIM_Base_Init(cfg->tim)!=HAL_OK)
 	{
-		timer_dev->TimerCfg->tim->Instance->SR &= ~TIM_IT_UPDATE;
-		glo_50ms++;
+		DEBUG_Assert(0);
 	}
+	timebaseTim->CR1 |= TIM_CR1_URS;		//以后只有计数溢出置UIF
+	timebaseTim->SR = ~TIM_SR_UIF;
+
+	HAL_NVIC_SetPriority(irq->irq_cfg.irq,irq->irq_cfg.nvic_preemptPriority,irq->irq_cfg.nvic_subPriority);
+	HAL_NVIC_EnableIRQ(irq->irq_cfg.irq);
+	timer_dev->IQRInited = false;
+	timer_dev->isInit = true;
+	Hal_Timer_5 = (uint32_t)timer_dev;
+	HAL_TIM_Base_Start_IT(cfg->tim);
 }
-#if 1
+
+/*
+ * 无锁读取,任务和任意优先级中断都可调用
+ * 两次读高位不同说明中间发生了溢出中断,重读
+ * 溢出标志已置位但中断还没执行(被更高优先级中断挡住),且计数已回绕,高位补一
+ */
 uint64_t GetMicro(void)
 {
-	uint16_t cnt;
-	cnt=TIM7->CNT;
-	return glo_50ms*50000+cnt;
-}
+	uint32_t high,cnt;
 
-uint32_t GetMillis(void)
-{
-	uint16_t cnt;
-	cnt=TIM7->CNT;
-	return glo_50ms*50+cnt/1000;
+	do{
+		high = timebaseHigh;
+		cnt = timebaseTim->CNT;
+		if((timebaseTim->SR & TIM_SR_UIF) != 0 && cnt < 0x80000000u)
+		{
+			high++;
+			break;
+		}
+	}while(high != timebaseHigh);
+	return ((uint64_t)high<<32) | cnt;
 }
-#else
-#define SystickUsTick   (HAL_RCC_GetHCLKFreq()/1000000)
-uint64_t GetMicro(void)
+
+/*
+ * 64位除以16位数,拆成四次32位硬件除法,避免调用__aeabi_uldivmod
+ */
+static uint64_t TimebaseDiv(uint64_t n,uint16_t d)
 {
-    uint64_t micro ;
-    micro = halSysTickCount * 1000;
-    micro += (SysTick->LOAD - SysTick->VAL)/SystickUsTick;
-    return micro;
+	uint64_t q = 0;
+	uint32_t r = 0;
+
+	for(int8_t shift = 48;shift >= 0;shift -= 16)
+	{
+		uint32_t x = (r<<16) | (uint16_t)(n>>shift);
+		q = (q<<16) | (x/d);
+		r = x%d;
+	}
+	return q;
 }
 
 uint32_t GetMillis(void)
 {
-    return HAL_GetTick();
+	return (uint32_t)TimebaseDiv(GetMicro(),1000);
 }
-#endif
 
+//时间戳换算成周期数,如PWM周期
+uint64_t TimebaseMicroToPeriods(uint64_t micro,uint16_t periodUs)
+{
+	DEBUG_Assert(periodUs != 0);
+	return TimebaseDiv(micro,periodUs);
+}
 
+uint64_t TimebasePeriodsToMicro(uint64_t periods,uint16_t periodUs)
+{
+	return periods*periodUs;
+}
@@ -13,7 +13,6 @@
 
 #include "board_hw_defs.h"
 #include "global.h"
-extern uint32_t Hal_Timer_ID;
 extern uint32_t Hal_Print_Tim_ID,Hal_motor_Tim_ID,Hal_can_Tim_ID;;
 
 typedef struct{
@@ -26,8 +25,11 @@ typedef struct{
 extern uint32_t Hal_Timer_4,Hal_Timer_5,Hal_Timer_6,Hal_Timer_7;
 
 void SysTimerTimInit(uint32_t *timer_tim_id,const GIMBAL_TIM_TIMER_CFG *cfg);
+void TimebaseInit(const GIMBAL_TIM_TIMER_CFG *cfg);
 uint64_t GetMicro(void);
 uint32_t GetMillis(void);
+uint64_t TimebaseMicroToPeriods(uint64_t micro,uint16_t periodUs);
+uint64_t TimebasePeriodsToMicro(uint64_t periods,uint16_t periodUs);
 #ifdef __cplusplus
  }
 #endif
@@ -2,6 +2,7 @@
 #include "stm32f4xx_hal.h"
 #include "canardmain.h"
 #include "global.h"
+#include "current.h"
 
 void hal_rcc_clk_enable(uint32_t instance)
 {
@@ -362,10 +363,10 @@ TIM_HandleTypeDef	TimerTim[] = {
 		},
 	},
 	[TimerChannel3] = {
-		.Instance = TIM5,
+		.Instance = TIM5,		//32位,1MHz自由计数的时基,溢出约71分钟
 		.Init = {
 			.Prescaler = 84-1,
-			.Period = 1000,
+			.Period = 0xFFFFFFFF,
 			.ClockDivision = TIM_CLOCKDIVISION_DIV1,
 			.CounterMode = TIM_COUNTERMODE_UP,//center-aligned mode selection
 		},
@@ -633,19 +634,36 @@ GIMBAL_TIM_PWMOUT_CFG const *GetPwmOutCfg(uint8_t i)
 }
 /*-----------------------------------------------------------------------*/
 
+//ADC1(Ia)为主,ADC2(Ib)为从,同步规则采样,T8_TRGO同时触发两路
 ADC_HandleTypeDef		PwmoutChan0CurrentSampleADCHandle = {
 	.Instance = ADC1,
 	.Init = {
 		.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4,
 		.Resolution = ADC_RESOLUTION_12B,
-		.ScanConvMode = ENABLE,
+		.ScanConvMode = DISABLE,
 		.ContinuousConvMode = DISABLE,
 		.DiscontinuousConvMode = DISABLE,
 		.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING,
 		.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T8_TRGO,
 		.DataAlign = ADC_DATAALIGN_RIGHT,
-		.NbrOfConversion = 2,
-		.DMAContinuousRequests = ENABLE,
+		.NbrOfConversion = 1,
+		.DMAContinuousRequests = DISABLE,
+		.EOCSelection = ADC_EOC_SINGLE_CONV,
+	},
+};
+ADC_HandleTypeDef		PwmoutChan0CurrentSampleADC2Handle = {
+	.Instance = ADC2,
+	.Init = {
+		.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4,
+		.Resolution = ADC_RESOLUTION_12B,
+		.ScanConvMode = DISABLE,
+		.ContinuousConvMode = DISABLE,
+		.DiscontinuousConvMode = DISABLE,
+		.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE,
+		.ExternalTrigConv = ADC_SOFTWARE_START,			//从ADC跟随主ADC触发
+		.DataAlign = ADC_DATAALIGN_RIGHT,
+		.NbrOfConversion = 1,
+		.DMAContinuousRequests = DISABLE,
 		.EOCSelection = ADC_EOC_SINGLE_CONV,
 	},
 };
@@ -675,18 +693,24 @@ ADC_HandleTypeDef		VoltageSampleADCHandle = {
 		.ContinuousConvMode		= DISABLE,
 		.DiscontinuousConvMode	= DISABLE,
 		.NbrOfConversion		= 1,
-		.ExternalTrigConv		= ADC_SOFTWARE_START,
-//		.EOCSelection = ADC_EOC_SINGLE_CONV,
+		.ExternalTrigConvEdge	= ADC_EXTERNALTRIGCONVEDGE_RISING,
+		.ExternalTrigConv		= ADC_EXTERNALTRIGCONV_T8_TRGO,	//与相电流同一个触发,每个PWM周期采一次母线
+		.EOCSelection = ADC_EOC_SINGLE_CONV,
 	},
 };
 
 const GIMBAL_ADC_CFG gimbalPwmout0CurSmpADCCfg = {
 	.hadc = &PwmoutChan0CurrentSampleADCHandle,
+	.hadcSlave = &PwmoutChan0CurrentSampleADC2Handle,
 	.irq_enabled = false,
-	.channelNum = 2,
-	.hdma = &_adc1Dma,
+#if CURRENT_THREE_SHUNT
+	.channelNum = 3,//两路同步采样,在三相里轮换
+#else
+	.channelNum = 2,//两路同步采样
+#endif
+	.hdma = NULL,//不用DMA,EOC中断直接读两路结果
 	.dmairq = {
-		.irq_enabled = true,
+		.irq_enabled = false,
 		.irq_cfg = {
 			.irq = DMA2_Stream0_IRQn,
 			.nvic_preemptPriority = IRQ_PRIO_MID,
@@ -695,6 +719,16 @@ const GIMBAL_ADC_CFG gimbalPwmout0CurSmpADCCfg = {
         .irqFlagNum = 1,
         .irqFlag[0] = DMA_IT_TC,
 	},
+	.adcirq = {
+		.irq_enabled = true,
+		.irq_cfg = {
+			.irq = ADC_IRQn,
+			.nvic_preemptPriority = IRQ_PRIO_MID,
+			.nvic_subPriority = 0,
+    	},
+        .irqFlagNum = 1,
+        .irqFlag[0] = ADC_IT_EOC,
+	},
 	.sConfig[0] = {
 		.Channel      = ADC_CHANNEL_3,
 		.Rank         = 1,
@@ -711,7 +745,7 @@ const GIMBAL_ADC_CFG gimbalPwmout0CurSmpADCCfg = {
 	},
 	.sConfig[1] = {
 		.Channel      = ADC_CHANNEL_4,
-		.Rank         = 2,
+		.Rank         = 1,					//从ADC的第一个转换
 		.SamplingTime = ADC_SAMPLETIME_3CYCLES,
 	},
 	.ADCGpio[1] = {
@@ -723,6 +757,22 @@ const GIMBAL_ADC_CFG gimbalPwmout0CurSmpADCCfg = {
 			.Speed = GPIO_SPEED_FREQ_MEDIUM,
 		},
 	},
+#if CURRENT_THREE_SHUNT
+	.sConfig[2] = {
+		.Channel      = ADC_CHANNEL_5,		//C相
+		.Rank         = 1,
+		.SamplingTime = ADC_SAMPLETIME_3CYCLES,
+	},
+	.ADCGpio[2] = {
+		.gpio = GPIOA,
+		.initTypeDef = {
+			.Pin = GPIO_PIN_5,
+			.Mode = GPIO_MODE_ANALOG,
+			.Pull = GPIO_NOPULL,
+			.Speed = GPIO_SPEED_FREQ_MEDIUM,
+		},
+	},
+#endif
 };
 
 const GIMBAL_ADC_CFG gimbalVoltageSmpADCCfg = {
@@ -10,6 +10,7 @@
 #include "timer.h"
 #include "board_hw_defs.h"
 #include "canardmain.h"
+#include "serialplot.h"
 /* USER CODE END Includes */
 
 /* Variables -----------------------------------------------------------------*/
@@ -46,6 +47,10 @@ void StatusTask(void const * argument);
 TaskHandle_t xHandleTaskMotoTest;
 void MotoTestTask(void const * argument);
 
+#define SerialPlot_TASK_PRIO           	26
+#define SerialPlot_STK_SIZE            	128
+TaskHandle_t xHandleTaskSerialPlot;
+
 void MX_FREERTOS_Init(void) {
 
   /* USER CODE BEGIN RTOS_QUEUES */
@@ -99,6 +104,14 @@ void StartTask(void const * argument)
               (UBaseType_t    )MotoTest_TASK_PRIO,
               (TaskHandle_t * )&xHandleTaskMotoTest);
 
+  //电流环遥测,排空ISR写入的环形缓冲
+  xTaskCreate((TaskFunction_t )SerialPlotTask,
+              (const char *  )"SerialPlot",
+              (uint16_t       )SerialPlot_STK_SIZE,
+              (void *         )NULL,
+              (UBaseType_t    )SerialPlot_TASK_PRIO,
+              (TaskHandle_t * )&xHandleTaskSerialPlot);
+
   vTaskDelete(xHandleTaskStart);
   taskEXIT_CRITICAL();
 }
@@ -114,9 +114,10 @@ int main(void)
   GimbalMotorSwitchGpioInit();
   GimbalBoardCfgCom((uint32_t)hal.usart0,USART_CONSOLE_RX_BUF,COM_USART_CONSOLE_RX_BUF_LEN,USART_CONSOLE_TX_BUF,COM_USART_CONSOLE_TX_BUF_LEN,&usart_driver,&comDebugId,false);
   systemPrintfInit();
-  SysTimerTimInit(&Hal_Timer_ID,hal.timer0);
+  TimebaseInit(hal.timer2);
   ADCSampleInit(&hal_ADC_Vol_ID,hal.adc1,false);
-  ADCSampleInit(&hal_ADC_pwmout_sample_id,hal.adc0,true);
+  ADCSampleInit(&hal_ADC_pwmout_sample_id,hal.adc0,false);
+  ADCBusVoltageLink(hal_ADC_pwmout_sample_id,hal_ADC_Vol_ID);
   MotorSvpwmTimInit(&Hal_Tim_pwmOut_ID,hal.pwmout0,hal_ADC_pwmout_sample_id);
   CanardRevBufferInit();
   CanardMainInit();
@@ -0,0 +1,361 @@
+/*
+ * bench.c
+ *
+ *  Host benchmark for the FOC hot path. Every case runs the real firmware
+ *  sources against the host shim and reports ns/call, calls/s and the share
+ *  of one PWM period (PWM_FREQUENCE_VAL) the call would take at host speed.
+ *  The absolute numbers are host numbers; compare runs against each other to
+ *  catch regressions, not against the target.
+ *
+ *  usage: bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "host_shim.h"
+#include "current.h"
+#include "svpwm.h"
+#include "motordriver.h"
+#include "tim_PWM_Output.h"
+#include "myMath.h"
+#include "foc_host.h"
+#include "serialplot.h"
+#include "isrprofile.h"
+#include "encoderlinear.h"
+#include "motorcali.h"
+
+#define BENCH_ITERATIONS_DEFAULT	2000000u
+#define BENCH_TABLE_SIZE			4096u
+
+static uint16_t		benchSample[BENCH_TABLE_SIZE][ADC_SAMPLE_NUM];
+static int32_t		benchValpha[BENCH_TABLE_SIZE];
+static int32_t		benchVbeta[BENCH_TABLE_SIZE];
+static float		benchIalpha[BENCH_TABLE_SIZE];
+static float		benchIbeta[BENCH_TABLE_SIZE];
+static Q15			benchIalphaQ15[BENCH_TABLE_SIZE];
+static Q15			benchIbetaQ15[BENCH_TABLE_SIZE];
+static float		benchEalpha[BENCH_TABLE_SIZE];
+static float		benchEbeta[BENCH_TABLE_SIZE];
+static SmoQ15		benchSmo;
+static volatile uint16_t	benchSink;
+static volatile float		benchSinkf;
+
+typedef struct{
+	const char	*name;
+	void		(*run)(uint32_t i);
+}BenchCase;
+
+static void BenchCurrentRunning(uint32_t i)
+{
+	HostAdvanceMicro(FOC_HOST_PWM_PERIOD_US);
+	ISR_PROFILE_BEGIN();
+	CurrentRunning(0,benchSample[i & (BENCH_TABLE_SIZE-1)]);
+}
+
+static void BenchSmoFloat(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	motor_fbk.Ialpha_fbk_pu = benchIalpha[k];
+	motor_fbk.Ibeta_fbk_pu = benchIbeta[k];
+	motor_Estimate.Ualpha_pll_compens = benchValpha[k]*(V_base/VALUE_Q15);
+	motor_Estimate.Ubeta_pll_compens = benchVbeta[k]*(V_base/VALUE_Q15);
+	motor_estimat_theta();
+}
+
+static void BenchSmoQ15(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	SmoQ15Update(&benchSmo,benchIalphaQ15[k],benchIbetaQ15[k],benchValpha[k]>>1,benchVbeta[k]>>1);
+	benchSink = benchSmo.Theta;
+}
+
+static void BenchAtan2f(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	benchSinkf = atan2f(-benchEalpha[k],benchEbeta[k]);
+}
+
+static void BenchPll(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	motor_Estimate.Ealpha_estimate_pu_filt = benchEalpha[k];
+	motor_Estimate.Ebeta_estimate_pu_filt = benchEbeta[k];
+	motor_estimat_pll();
+}
+
+static void BenchSvpwm(uint32_t i)
+{
+	uint16_t pulse[MotorPhase_Num];
+	svpwm(i,pulse,2867,focHostMotorCfg.PhasePulseMax);
+	benchSink = pulse[0] ^ pulse[1] ^ pulse[2];
+}
+
+static void BenchSvpwm2(uint32_t i)
+{
+	uint16_t pulse[MotorPhase_Num];
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	svpwm2(benchValpha[k],benchVbeta[k],pulse,(uint16_t)(focHostMotorCfg.PhasePulseMax*0.57735f),focHostMotorCfg.PhasePulseMax>>1);
+	benchSink = pulse[0] ^ pulse[1] ^ pulse[2];
+}
+
+static void BenchSvpwmGenerateOpenLoop(uint32_t i)
+{
+	svpwmDri.outPut(svpwmID,0.35f,0,i,false);
+}
+
+static void BenchSvpwmGenerateClosedLoop(uint32_t i)
+{
+	svpwmDri.outPut(svpwmID,0.35f,i & (BENCH_TABLE_SIZE-1),0,true);
+}
+
+/* consumer keeps up: every push finds room */
+static void BenchPlotPush(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	clPlotBuff.R = clPlotBuff.W;
+	SerialPlotRingPush(benchIalpha[k],benchIbeta[k]);
+}
+
+/* consumer stalled: every push is dropped and counted */
+static void BenchPlotPushFull(uint32_t i)
+{
+	uint32_t k = i & (BENCH_TABLE_SIZE-1);
+	clPlotBuff.R = clPlotBuff.W - SERIALPLOT_RING_LEN;
+	SerialPlotRingPush(benchIalpha[k],benchIbeta[k]);
+}
+
+static const BenchCase benchCase[] = {
+	{"CurrentRunning",				BenchCurrentRunning},
+	{"motor_estimat_theta (float)",	BenchSmoFloat},
+	{"SmoQ15Update",				BenchSmoQ15},
+	{"angle: atan2f",				BenchAtan2f},
+	{"angle: motor_estimat_pll",	BenchPll},
+	{"svpwm",						BenchSvpwm},
+	{"svpwm2",						BenchSvpwm2},
+	{"SvpwmGenerate (open loop)",	BenchSvpwmGenerateOpenLoop},
+	{"SvpwmGenerate (closed loop)",	BenchSvpwmGenerateClosedLoop},
+	{"SerialPlotRingPush",			BenchPlotPush},
+	{"SerialPlotRingPush (full)",	BenchPlotPushFull},
+};
+
+static void BenchTableInit(void)
+{
+	for(uint32_t i = 0;i<BENCH_TABLE_SIZE;i++)
+	{
+		float theta = 2*PI*i/BENCH_TABLE_SIZE;
+		benchSample[i][0] = 2048 + 400*cosf(theta);
+		benchSample[i][1] = 2048 + 400*cosf(theta - 2*PI/3);
+		benchSample[i][2] = 2048 + 400*cosf(theta + 2*PI/3);
+		benchSample[i][ADC_SAMPLE_VBUS] = VDC_BUS/VBUS_ADC_FACTOR;
+#if CURRENT_THREE_SHUNT
+		/* cycle the unsampled phase so every reconstruction branch is timed */
+		benchSample[i][i % MotorPhase_Num] = ADC_SHUNT_SKIPPED;
+#endif
+		benchValpha[i] = 0.8f*VALUE_Q15*cosf(theta);
+		benchVbeta[i] = 0.8f*VALUE_Q15*sinf(theta);
+		benchIalpha[i] = 0.3f*cosf(theta - 0.3f);
+		benchIbeta[i] = 0.3f*sinf(theta - 0.3f);
+		benchIalphaQ15[i] = benchIalpha[i]/SMO_I_BASE*VALUE_Q15;
+		benchIbetaQ15[i] = benchIbeta[i]/SMO_I_BASE*VALUE_Q15;
+		benchEalpha[i] = -0.01f*sinf(theta);
+		benchEbeta[i] = 0.01f*cosf(theta);
+	}
+}
+
+/*
+ * Golden vector for the fixed-point observer: a fixed input sequence folded
+ * into a checksum. The same sequence on the target must give the same value.
+ */
+static uint32_t BenchSmoQ15Checksum(void)
+{
+	SmoQ15 smo;
+	uint32_t sum = 2166136261u;
+	SmoQ15Init(&smo,MOTOR_RS,MOTOR_LD,1.0f/PWM_FREQUENCE_VAL,0.01f,0.1f,SMO_U_BASE,SMO_I_BASE);
+	for(uint32_t i = 0;i<4*BENCH_TABLE_SIZE;i++)
+	{
+		uint32_t k = (i*7) & (BENCH_TABLE_SIZE-1);
+		SmoQ15Update(&smo,benchIalphaQ15[k],benchIbetaQ15[k],benchValpha[k]>>1,benchVbeta[k]>>1);
+		sum = (sum ^ (uint32_t)smo.Ealpha_estimate_filt)*16777619u;
+		sum = (sum ^ (uint32_t)smo.Ebeta_estimate_filt)*16777619u;
+		sum = (sum ^ smo.Theta)*16777619u;
+	}
+	return sum;
+}
+
+/*
+ * Angle jitter of atan2f against the PLL on a back-EMF vector turning at
+ * BENCH_JITTER_OMEGA with white noise of BENCH_JITTER_NOISE times its
+ * amplitude. The mean error is removed; the first half second is settling.
+ */
+#define BENCH_JITTER_OMEGA		300.0f
+#define BENCH_JITTER_NOISE		0.2f
+#define BENCH_JITTER_SECONDS	2.0f
+
+static float BenchWrapPi(float x)
+{
+	while(x > PI)	x -= 2*PI;
+	while(x < -PI)	x += 2*PI;
+	return x;
+}
+
+static void BenchAngleJitter(void)
+{
+	uint32_t n = BENCH_JITTER_SECONDS*PWM_FREQUENCE_VAL;
+	uint32_t settle = PWM_FREQUENCE_VAL/2;
+	uint32_t seed = 1;
+	double sum[2] = {0},sum2[2] = {0};
+	float theta = 0;
+
+	motor_Estimate.Theta_estimate = 0;
+	motor_Estimate.Omega_estimate = 0;
+	for(uint32_t k = 0;k<n;k++)
+	{
+		float noise[2],err[2];
+		for(uint8_t j = 0;j<2;j++)
+		{
+			seed = seed*1664525u + 1013904223u;
+			noise[j] = BENCH_JITTER_NOISE*(((int32_t)(seed >> 8) - (1<<23))/(float)(1<<23))*1.7320508f;
+		}
+		theta = BenchWrapPi(theta + BENCH_JITTER_OMEGA/PWM_FREQUENCE_VAL);
+		motor_Estimate.Ealpha_estimate_pu_filt = -sinf(theta) + noise[0];
+		motor_Estimate.Ebeta_estimate_pu_filt = cosf(theta) + noise[1];
+		motor_estimat_pll();
+		err[0] = BenchWrapPi(atan2f(-motor_Estimate.Ealpha_estimate_pu_filt,motor_Estimate.Ebeta_estimate_pu_filt) - theta);
+		err[1] = BenchWrapPi(motor_Estimate.Theta_estimate - theta);
+		if(k < settle)
+			continue;
+		for(uint8_t j = 0;j<2;j++)
+		{
+			sum[j] += err[j];
+			sum2[j] += err[j]*err[j];
+		}
+	}
+	n -= settle;
+	printf("angle jitter, |E| noise %.0f%% rms at %.0f rad/s:\n",BENCH_JITTER_NOISE*100,BENCH_JITTER_OMEGA);
+	printf("  %-28s %8.3f deg rms\n","atan2f",sqrt(sum2[0]/n - (sum[0]/n)*(sum[0]/n))*KP_RAD2ANGLE);
+	printf("  %-28s %8.3f deg rms\n","motor_estimat_pll",sqrt(sum2[1]/n - (sum[1]/n)*(sum[1]/n))*KP_RAD2ANGLE);
+}
+
+/*
+ * Closed-loop encoder->vector mapping against the exact pos*pole/PPR turn,
+ * including PPRs that are not a multiple of the pole count.
+ */
+static void BenchEncoderMapping(void)
+{
+	static const uint16_t combo[][2] = {{4096,11},{4000,7},{16384,21},{2048,4},{1000,11}};
+	static MotorCfg cfg;			//ids are 32-bit: keep it out of the stack
+	SvpwmDrive *drive = (SvpwmDrive *)svpwmID;
+
+	printf("encoder->vector mapping (max error, steps of 4096):\n");
+	for(uint8_t c = 0;c<NELEMENTS(combo);c++)
+	{
+		double maxErr = 0;
+		cfg = focHostMotorCfg;
+		cfg.encodePPR = combo[c][0];
+		cfg.pole = combo[c][1];
+		cfg.encodeZeroPos = 0;
+		svpwmDri.SetMotorConfig(svpwmID,(uint32_t)&cfg);
+		for(uint32_t pos = 0;pos<cfg.encodePPR;pos++)
+		{
+			double exact = fmod((double)pos*cfg.pole*SvpwmDriverRad/cfg.encodePPR + SvpwmDriverRad_Quart,SvpwmDriverRad);
+			double err;
+			svpwmDri.outPut(svpwmID,0.1f,pos,0,true);
+			err = fabs(drive->vectorPos - exact);
+			if(err > SvpwmDriverRad/2)
+				err = SvpwmDriverRad - err;
+			if(err > maxErr)
+				maxErr = err;
+		}
+		printf("  PPR %5u pole %2u  %6.3f\n",cfg.encodePPR,cfg.pole,maxErr);
+	}
+	svpwmDri.SetMotorConfig(svpwmID,(uint32_t)&focHostMotorCfg);
+}
+
+/*
+ * Calibration records round trip through the RAM image the way MotoTestTask
+ * and the boot path use them; the records are longer than 255 bytes.
+ */
+static void BenchFlashRecord(void)
+{
+	static EncoderLinearRecord linear;		//addresses are 32-bit: keep them out of the stack
+	static MotorZeroPosRecord zero;
+	static int16_t correct[ENCODER_LINEAR_AXIS_NUM][ENCODER_LINEAR_POINTS];
+	int16_t back[ENCODER_LINEAR_POINTS];
+	bool ok = true;
+
+	EncoderLinearClear((uint32_t)&linear);
+	ok &= !EncoderLinearLoad(back,0,(uint32_t)&linear);
+	for(uint8_t axis = 0;axis<ENCODER_LINEAR_AXIS_NUM;axis++)
+	{
+		for(uint16_t i = 0;i<ENCODER_LINEAR_POINTS;i++)
+			correct[axis][i] = (i*37 + axis*1000) % 4001 - 2000;
+		EncoderLinearStore((uint32_t)&linear,axis,correct[axis]);
+	}
+	for(uint8_t axis = 0;axis<ENCODER_LINEAR_AXIS_NUM;axis++)
+	{
+		ok &= EncoderLinearLoad(back,axis,(uint32_t)&linear);
+		ok &= memcmp(back,correct[axis],sizeof(back)) == 0;
+	}
+	linear.Correct[0][0]++;
+	ok &= !EncoderLinearLoad(back,0,(uint32_t)&linear);
+	printf("calibration records:\n");
+	printf("  %-28s %u bytes  %s\n","encoder linear store/load",(unsigned)sizeof(linear),ok ? "ok" : "FAIL");
+
+	ok = true;
+	MotorZeroPosClear((uint32_t)&zero);
+	MotorZeroPosStore((uint32_t)&zero,0,1234);
+	{
+		MotorCfg cfg = focHostMotorCfg;
+		ok &= MotorZeroPosLoad(&cfg,0,(uint32_t)&zero) && cfg.encodeZeroPos == 1234;
+	}
+	printf("  %-28s %u bytes  %s\n","motor zero store/load",(unsigned)sizeof(zero),ok ? "ok" : "FAIL");
+}
+
+static void BenchDriverInit(void)
+{
+	FocHostInit();
+	benchSmo = motor_smo;
+	/* let adc_zero() settle on mid-scale samples before timing anything */
+	while(!adc_result.haszero)
+	{
+		uint16_t zero[ADC_SAMPLE_NUM] = {2048,2048,2048,ADC_VBUS_NONE};
+		HostAdvanceMicro(FOC_HOST_PWM_PERIOD_US);
+		CurrentRunning(0,zero);
+	}
+}
+
+int main(int argc,char *argv[])
+{
+	uint32_t iterations = BENCH_ITERATIONS_DEFAULT;
+	double budget_ns = 1e9/PWM_FREQUENCE_VAL;
+
+	if(argc > 1)
+		iterations = strtoul(argv[1],NULL,0);
+	if(iterations == 0)
+		iterations = BENCH_ITERATIONS_DEFAULT;
+
+	BenchTableInit();
+	BenchDriverInit();
+
+	printf("%-30s %12s %14s %10s\n","case","ns/call","calls/s","% period");
+	for(uint8_t c = 0;c<NELEMENTS(benchCase);c++)
+	{
+		uint64_t start,elapsed;
+		double ns;
+		/* warm caches and branch predictors */
+		for(uint32_t i = 0;i<iterations/16;i++)
+			benchCase[c].run(i);
+		start = HostNanos();
+		for(uint32_t i = 0;i<iterations;i++)
+			benchCase[c].run(i);
+		elapsed = HostNanos() - start;
+		ns = (double)elapsed/iterations;
+		printf("%-30s %12.1f %14.0f %9.2f%%\n",benchCase[c].name,ns,1e9/ns,100*ns/budget_ns);
+	}
+	printf("SmoQ15 golden checksum 0x%08x\n",BenchSmoQ15Checksum());
+	BenchAngleJitter();
+	BenchEncoderMapping();
+	BenchFlashRecord();
+	return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * foc_host.c
+ *
+ *  Host bring-up of the motor driver chain, mirroring MotoTestTask.
+ */
+#include "foc_host.h"
+#include "host_shim.h"
+#include "current.h"
+#include "svpwm.h"
+#include "motordriver.h"
+#include "tim_PWM_Output.h"
+
+MotorCfg	focHostMotorCfg={
+	.encodePPR = 4096,
+	.pole = 11,
+	.PhasePulseMax = 2000,
+	.isUplseReverse = MotorRotateReverse_ACB,
+};
+
+void FocHostInit(void)
+{
+	HostShimInit();
+	svpwmArrayQ12Init();
+	MotorSvpwmTimInit(&Hal_Tim_pwmOut_ID,&hostPwmOutCfg,0);
+	SvpwmDriverPulseUpdateFunRegister(&svpwmID,Hal_Tim_pwmOut_ID,(uint32_t)CurrentLoopPulseUpdate);
+	svpwmDri.SetMotorConfig(svpwmID,(uint32_t)&focHostMotorCfg);
+	MotorInit();
+}
+
+/* compare values of phase A/B/C in TimChannel[] order, as the timer holds them */
+void FocHostReadCcr(uint32_t ccr[3],uint32_t *arr)
+{
+	TIM_TypeDef *tim = hostPwmOutCfg.tim->Instance;
+	for(uint8_t j = 0;j<MotorPhase_Num;j++)
+	{
+		switch(hostPwmOutCfg.TimChannel[j])
+		{
+			case TIM_CHANNEL_1:	ccr[j] = tim->CCR1;	break;
+			case TIM_CHANNEL_2:	ccr[j] = tim->CCR2;	break;
+			case TIM_CHANNEL_3:	ccr[j] = tim->CCR3;	break;
+			case TIM_CHANNEL_4:	ccr[j] = tim->CCR4;	break;
+			default:ccr[j] = 0;break;
+		}
+	}
+	*arr = tim->ARR;
+}
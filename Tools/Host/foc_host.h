@@ -0,0 +1,21 @@
+/*
+ * foc_host.h
+ *
+ *  Host bring-up of the motor driver chain, mirroring MotoTestTask: svpwm
+ *  table, TIM8 pulse output, svpwm driver and MotorInit.
+ */
+
+#ifndef FOC_HOST_H_
+#define FOC_HOST_H_
+
+#include "motorConfig.h"
+#include "current.h"
+
+#define FOC_HOST_PWM_PERIOD_US		(1000000u/PWM_FREQUENCE_VAL)
+
+extern MotorCfg	focHostMotorCfg;
+
+void FocHostInit(void);
+void FocHostReadCcr(uint32_t ccr[3],uint32_t *arr);
+
+#endif /* FOC_HOST_H_ */
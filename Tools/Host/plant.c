@@ -0,0 +1,194 @@
+/*
+ * plant.c
+ *
+ *  Discrete-time PMSM model driven by the TIM8 compare values.
+ *
+ *  vd = Rs*id + Ld*did/dt - we*Lq*iq
+ *  vq = Rs*iq + Lq*diq/dt + we*(Ld*id + flux)
+ *  Te = 1.5*p*(flux*iq + (Ld-Lq)*id*iq)
+ *  J*dwm/dt = Te - B*wm - Tload
+ */
+#include <math.h>
+#include "plant.h"
+#include "current.h"
+
+#define PLANT_SUBSTEPS		2
+#define PLANT_2PI			6.2831853f
+#define PLANT_SQRT3			1.7320508f
+#define PLANT_DT_IBAND		0.01f		//A, current ripple smooths the dead-time step
+
+void PlantDefaultParam(PlantParam *p)
+{
+	p->Rs = MOTOR_RS;
+	p->Ld = MOTOR_LD;
+	p->Lq = MOTOR_LQ;
+	p->flux = MOTOR_FLUX;
+	p->polePairs = MOTOR_POLES_VAL;
+	p->J = 2e-5f;
+	p->B = 2e-5f;
+	p->Vdc = VDC_BUS;
+	p->adcAmpPerLsb = 0.000805664f;
+	p->adcZero = 2048;
+	p->adcNoiseLsb = 0;
+	p->vbusVoltPerLsb = VBUS_ADC_FACTOR;
+	/* CurrentLoopPulseUpdate reconstructs Ua = (1050 - pulse)*12/1050, i.e.
+	 * the output stage drives the leg low while the channel is active */
+	p->invertedLegs = true;
+	/* 2 us of low-side on-time (two windows of CCR counts at 84 MHz) for the
+	 * shunt amplifier to settle */
+	p->shuntMinCcr = 84;
+	p->deadTimeNs = 300;
+	p->deviceDrop = 0.05f;
+}
+
+void PlantInit(Plant *plant,const PlantParam *p)
+{
+	plant->p = *p;
+	plant->id = plant->iq = 0;
+	plant->omegaM = 0;
+	plant->thetaM = 0;
+	plant->thetaE = 0;
+	plant->sinE = 0;
+	plant->cosE = 1;
+	plant->loadTorque = 0;
+	plant->speedHold = false;
+	plant->va = plant->vb = plant->vc = 0;
+	plant->ia = plant->ib = plant->ic = 0;
+	/* bridge idle until the first PlantApplyCcr, no window to violate */
+	plant->lowCcr[0] = plant->lowCcr[1] = plant->lowCcr[2] = UINT32_MAX;
+	plant->shuntGlitch = 0;
+	plant->noiseSeed = 0x1234567u;
+}
+
+/*
+ * During dead time the diodes clamp the leg by current direction: current
+ * flowing out of the leg loses Td*fpwm*Vdc of average voltage, plus the
+ * device drop while conducting.
+ */
+static float PlantDeadTimeLoss(const Plant *plant,float i)
+{
+	float s = i/PLANT_DT_IBAND;
+	if(s > 1) s = 1;
+	if(s < -1) s = -1;
+	return s*(plant->p.deadTimeNs*1e-9f*PWM_FREQUENCE_VAL*plant->p.Vdc + plant->p.deviceDrop);
+}
+
+void PlantApplyCcr(Plant *plant,uint32_t ccrA,uint32_t ccrB,uint32_t ccrC,uint32_t arr)
+{
+	float k = plant->p.Vdc/arr;
+	if(ccrA > arr) ccrA = arr;
+	if(ccrB > arr) ccrB = arr;
+	if(ccrC > arr) ccrC = arr;
+	plant->lowCcr[0] = plant->p.invertedLegs ? ccrA : arr - ccrA;
+	plant->lowCcr[1] = plant->p.invertedLegs ? ccrB : arr - ccrB;
+	plant->lowCcr[2] = plant->p.invertedLegs ? ccrC : arr - ccrC;
+	if(plant->p.invertedLegs)
+	{
+		ccrA = arr - ccrA;
+		ccrB = arr - ccrB;
+		ccrC = arr - ccrC;
+	}
+	plant->va = k*ccrA - PlantDeadTimeLoss(plant,plant->ia);
+	plant->vb = k*ccrB - PlantDeadTimeLoss(plant,plant->ib);
+	plant->vc = k*ccrC - PlantDeadTimeLoss(plant,plant->ic);
+}
+
+float PlantOmegaE(const Plant *plant)
+{
+	return plant->omegaM*plant->p.polePairs;
+}
+
+void PlantStep(Plant *plant,float dt)
+{
+	const PlantParam *p = &plant->p;
+	float valpha = (2*plant->va - plant->vb - plant->vc)/3.0f;
+	float vbeta = (plant->vb - plant->vc)/PLANT_SQRT3;
+	float h = dt/PLANT_SUBSTEPS;
+	float s = plant->sinE;
+	float c = plant->cosE;
+
+	for(uint8_t n = 0;n<PLANT_SUBSTEPS;n++)
+	{
+		float we = PlantOmegaE(plant);
+		float vd = valpha*c + vbeta*s;
+		float vq = -valpha*s + vbeta*c;
+		float did = (vd - p->Rs*plant->id + we*p->Lq*plant->iq)/p->Ld;
+		float diq = (vq - p->Rs*plant->iq - we*(p->Ld*plant->id + p->flux))/p->Lq;
+		float te = 1.5f*p->polePairs*(p->flux*plant->iq + (p->Ld - p->Lq)*plant->id*plant->iq);
+		float dtheta = we*h;
+
+		plant->id += did*h;
+		plant->iq += diq*h;
+		if(!plant->speedHold)
+			plant->omegaM += (te - p->B*plant->omegaM - plant->loadTorque)/p->J*h;
+		plant->thetaM += plant->omegaM*h;
+		plant->thetaE += dtheta;
+		while(plant->thetaE >= PLANT_2PI)	plant->thetaE -= PLANT_2PI;
+		while(plant->thetaE < 0)			plant->thetaE += PLANT_2PI;
+		/* rotate instead of sinf/cosf per substep, renormalised once per step below */
+		{
+			float ds = dtheta - dtheta*dtheta*dtheta*(1.0f/6);
+			float dc = 1 - dtheta*dtheta*0.5f;
+			float sn = s*dc + c*ds;
+			c = c*dc - s*ds;
+			s = sn;
+		}
+	}
+	s = sinf(plant->thetaE);
+	c = cosf(plant->thetaE);
+	plant->sinE = s;
+	plant->cosE = c;
+
+	{
+		float ialpha = plant->id*c - plant->iq*s;
+		float ibeta = plant->id*s + plant->iq*c;
+		plant->ia = ialpha;
+		plant->ib = -0.5f*ialpha + 0.5f*PLANT_SQRT3*ibeta;
+		plant->ic = -plant->ia - plant->ib;
+	}
+}
+
+static float PlantNoise(Plant *plant)
+{
+	plant->noiseSeed = plant->noiseSeed*1664525u + 1013904223u;
+	return ((int32_t)(plant->noiseSeed >> 8) - (1<<23))/(float)(1<<23);
+}
+
+static uint16_t PlantAdcConvert(Plant *plant,float i)
+{
+	float counts = plant->p.adcZero + i/plant->p.adcAmpPerLsb;
+	if(plant->p.adcNoiseLsb != 0)
+		counts += plant->p.adcNoiseLsb*PlantNoise(plant);
+	counts = floorf(counts + 0.5f);
+	if(counts < 0)
+		counts = 0;
+	if(counts > 4095)
+		counts = 4095;
+	return (uint16_t)counts;
+}
+
+/*
+ * Samples the two legs other than skip; sample[skip] gets ADC_SHUNT_SKIPPED.
+ * sample[ADC_SAMPLE_VBUS] is the bus voltage ADC3 converts on the same trigger.
+ * A leg whose low side conducts for less than shuntMinCcr reads zero current,
+ * which is what a low-side shunt sees when the top switch carries the phase.
+ */
+void PlantAdcSample(Plant *plant,uint16_t sample[ADC_SAMPLE_NUM],uint8_t skip)
+{
+	float i[3] = {plant->ia,plant->ib,plant->ic};
+	for(uint8_t j = 0;j<3;j++)
+	{
+		if(j == skip)
+		{
+			sample[j] = ADC_SHUNT_SKIPPED;
+			continue;
+		}
+		if(plant->lowCcr[j] < plant->p.shuntMinCcr)
+		{
+			i[j] = 0;
+			plant->shuntGlitch++;
+		}
+		sample[j] = PlantAdcConvert(plant,i[j]);
+	}
+	sample[ADC_SAMPLE_VBUS] = floorf(plant->p.Vdc/plant->p.vbusVoltPerLsb + 0.5f);
+}
@@ -0,0 +1,59 @@
+/*
+ * plant.h
+ *
+ *  Discrete-time PMSM + inverter + current-sense model for the host harness.
+ *  Electrical dynamics are integrated in the rotor dq frame, so Ld != Lq
+ *  saliency is modelled; the mechanical side is a single inertia with viscous
+ *  friction and an external load torque.
+ */
+
+#ifndef PLANT_H_
+#define PLANT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "current.h"
+
+typedef struct{
+	float Rs;				//ohm
+	float Ld;				//H
+	float Lq;				//H
+	float flux;				//Wb, permanent magnet flux linkage
+	uint16_t polePairs;
+	float J;				//kg*m^2
+	float B;				//N*m*s/rad
+	float Vdc;				//V
+	float adcAmpPerLsb;		//A per ADC count, matches motor_fbk.I_fbk_factor
+	uint16_t adcZero;		//ADC count at zero current
+	float adcNoiseLsb;		//peak uniform noise added to each sample
+	float vbusVoltPerLsb;	//bus divider + ADC3, matches VBUS_ADC_FACTOR
+	bool invertedLegs;		//leg voltage = Vdc*(ARR-CCR)/ARR, see PlantApplyCcr
+	uint16_t shuntMinCcr;	//low-side compare below which a shunt reads no current
+	float deadTimeNs;		//per-edge blanking + switching delay of each leg
+	float deviceDrop;		//V, switch/diode forward drop
+}PlantParam;
+
+typedef struct{
+	PlantParam p;
+	float id,iq;
+	float omegaM;			//rad/s mechanical
+	float thetaM;			//rad mechanical, unwrapped
+	float thetaE;			//rad electrical, 0..2pi
+	float sinE,cosE;
+	float loadTorque;
+	bool speedHold;			//dynamometer: omegaM stays where it was set
+	float va,vb,vc;			//leg voltages latched for the running period
+	float ia,ib,ic;
+	uint32_t lowCcr[3];		//low-side on-time of each leg in compare counts
+	uint32_t shuntGlitch;	//samples taken from a leg whose low side was too short
+	uint32_t noiseSeed;
+}Plant;
+
+void PlantDefaultParam(PlantParam *p);
+void PlantInit(Plant *plant,const PlantParam *p);
+void PlantApplyCcr(Plant *plant,uint32_t ccrA,uint32_t ccrB,uint32_t ccrC,uint32_t arr);
+void PlantStep(Plant *plant,float dt);
+void PlantAdcSample(Plant *plant,uint16_t sample[ADC_SAMPLE_NUM],uint8_t skip);
+float PlantOmegaE(const Plant *plant);
+
+#endif /* PLANT_H_ */
@@ -0,0 +1,21 @@
+/*
+ * FreeRTOS.h (host shim)
+ *
+ *  Only the heap entry points and tick types used by the modules built on
+ *  the host.
+ */
+
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+#define portTickType		TickType_t
+#define portTICK_RATE_MS	((TickType_t)1)
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+
+#endif /* HOST_FREERTOS_H_ */
@@ -0,0 +1,188 @@
+/*
+ * host_shim.c
+ *
+ *  Thin HAL/TIM/ADC shim that lets the FOC hot path build and run on a host.
+ *  Peripheral init calls succeed without side effects, compare registers land
+ *  in RAM images and time advances only when the harness says so, so every
+ *  run is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "host_shim.h"
+#include "timer.h"
+#include "pios_com.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+TIM_TypeDef		HostTIM1Regs;
+TIM_TypeDef		HostTIM7Regs;
+TIM_TypeDef		HostTIM8Regs;
+DWT_Type		HostDWTRegs;
+CoreDebug_Type	HostCoreDebugRegs;
+
+uint32_t SystemCoreClock = 168000000;
+
+uint32_t comDebugId;
+
+static uint64_t	hostMicro;
+
+#define HOST_HEAP_SIZE		(16*1024)
+static uint8_t	hostHeap[HOST_HEAP_SIZE] __attribute__((aligned(8)));
+static size_t	hostHeapUsed;
+
+static TIM_HandleTypeDef	hostPwmOutTim = {
+	.Instance = TIM8,
+	.Init = {
+		.Prescaler = 2-1,
+		.Period = 2100,
+		.ClockDivision = TIM_CLOCKDIVISION_DIV1,
+		.CounterMode = TIM_COUNTERMODE_CENTERALIGNED2,
+	},
+};
+
+const GIMBAL_TIM_PWMOUT_CFG hostPwmOutCfg = {
+	.tim = &hostPwmOutTim,
+	.sMC = {
+		.MasterOutputTrigger = TIM_TRGO_OC1REF,
+		.MasterSlaveMode = TIM_MASTERSLAVEMODE_ENABLE,
+	},
+	.oc	= {
+		.OCMode = TIM_OCMODE_PWM1,
+		.OCPolarity		= TIM_OCPOLARITY_HIGH,
+		.Pulse 			= 2000,
+	},
+	.CCTimChannel = TIM_CHANNEL_1,
+	.TimChannel[MotorPhase1] = TIM_CHANNEL_2,
+	.TimChannel[MotorPhase2] = TIM_CHANNEL_3,
+	.TimChannel[MotorPhase3] = TIM_CHANNEL_4,
+};
+
+void HostShimInit(void)
+{
+	/* The drivers hand out ids as uint32_t, which only round-trips on the host
+	 * while the heap sits below 4 GiB (the Makefile links with -no-pie). */
+	void *probe = malloc(sizeof(uint32_t));
+	if(((uintptr_t)probe >> 32) != 0)
+	{
+		fprintf(stderr,"host heap above 4 GiB, uint32_t driver ids would truncate\n");
+		exit(1);
+	}
+	free(probe);
+	hostMicro = 0;
+}
+
+void HostAdvanceMicro(uint32_t us)
+{
+	hostMicro += us;
+	HostTIM7Regs.CNT = hostMicro % 50000;
+}
+
+uint64_t HostNanos(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/* TSC ticks on x86, nanoseconds elsewhere; only differences are used */
+uint32_t HostCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	return (uint32_t)HostNanos();
+#endif
+}
+
+uint64_t GetMicro(void)
+{
+	return hostMicro;
+}
+
+uint32_t GetMillis(void)
+{
+	return hostMicro/1000;
+}
+
+void *pvPortMalloc(size_t xSize)
+{
+	void *p;
+	xSize = (xSize + 7) & ~(size_t)7;
+	if(hostHeapUsed + xSize > HOST_HEAP_SIZE)
+		return NULL;
+	p = &hostHeap[hostHeapUsed];
+	hostHeapUsed += xSize;
+	return p;
+}
+
+void vPortFree(void *pv)
+{
+	(void)pv;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(hostMicro/1000);
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+	*pxPreviousWakeTime += xTimeIncrement;
+}
+
+int32_t PIOS_COM_SendBufferNonBlocking(uint32_t com_id, const uint8_t *buffer, uint16_t len)
+{
+	(void)com_id;
+	(void)buffer;
+	return len;
+}
+
+void hal_rcc_clk_enable(uint32_t instance)
+{
+	(void)instance;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+	(void)GPIOx;
+	(void)GPIO_Init;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+	htim->Instance->ARR = htim->Init.Period;
+	htim->Instance->PSC = htim->Init.Prescaler;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_DeInit(TIM_HandleTypeDef *htim)
+{
+	(void)htim;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig)
+{
+	(void)htim;
+	(void)sMasterConfig;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel)
+{
+	(void)htim;
+	(void)sConfig;
+	(void)Channel;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+	(void)htim;
+	(void)Channel;
+	return HAL_OK;
+}
@@ -0,0 +1,21 @@
+/*
+ * host_shim.h
+ *
+ *  Host side of the HAL/TIM/ADC shim. Provides the simulated microsecond clock
+ *  behind GetMicro and a TIM8 configuration mirroring
+ *  gimbalPWMOutCfg[MotorOutPutChannel1] in Src/board_hw_defs.c.
+ */
+
+#ifndef HOST_SHIM_H_
+#define HOST_SHIM_H_
+
+#include <stdint.h>
+#include "board_hw_defs.h"
+
+extern const GIMBAL_TIM_PWMOUT_CFG hostPwmOutCfg;
+
+void HostShimInit(void);
+void HostAdvanceMicro(uint32_t us);
+uint64_t HostNanos(void);
+
+#endif /* HOST_SHIM_H_ */
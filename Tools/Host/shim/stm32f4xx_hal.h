@@ -0,0 +1,47 @@
+/*
+ * stm32f4xx_hal.h (host shim)
+ *
+ *  Host (x86 Linux) stand-in for the HAL entry header. The real HAL and CMSIS
+ *  headers are used for every type and register layout; only the peripheral
+ *  instances touched by the FOC hot path are redirected from their fixed
+ *  addresses to RAM images that the host harness can read back.
+ */
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+#include "../../../Drivers/STM32F4xx_HAL_Driver/Inc/stm32f4xx_hal.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern TIM_TypeDef		HostTIM1Regs;
+extern TIM_TypeDef		HostTIM7Regs;
+extern TIM_TypeDef		HostTIM8Regs;
+
+#undef TIM1
+#undef TIM7
+#undef TIM8
+#define TIM1				(&HostTIM1Regs)
+#define TIM7				(&HostTIM7Regs)
+#define TIM8				(&HostTIM8Regs)
+
+/*
+ * DWT/CoreDebug land in RAM so IsrProfileInit runs unchanged; the RAM image
+ * has no free-running counter, so the profiler reads the host TSC instead.
+ */
+extern DWT_Type			HostDWTRegs;
+extern CoreDebug_Type	HostCoreDebugRegs;
+uint32_t HostCycles(void);
+
+#undef DWT
+#undef CoreDebug
+#define DWT					(&HostDWTRegs)
+#define CoreDebug			(&HostCoreDebugRegs)
+#define ISR_PROFILE_CYCCNT()	HostCycles()
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_STM32F4XX_HAL_H_ */
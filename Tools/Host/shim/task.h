@@ -0,0 +1,16 @@
+/*
+ * task.h (host shim)
+ *
+ *  Tick functions for the task bodies linked into the host build; the host
+ *  never runs the scheduler, so they only keep the link complete.
+ */
+
+#ifndef HOST_TASK_H_
+#define HOST_TASK_H_
+
+#include "FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+
+#endif /* HOST_TASK_H_ */
@@ -0,0 +1,880 @@
+/*
+ * sim.c
+ *
+ *  Closed-loop host simulation: the PMSM plant produces the Ia/Ib ADC samples,
+ *  CurrentRunning runs once per PWM period exactly as ADC_IRQHandler would
+ *  call it (two phase currents sampled at the same instant; with
+ *  CURRENT_THREE_SHUNT the pair is the one adc_result.shunt_next asked for
+ *  in the previous period), and the TIM8
+ *  compare values it leaves behind drive the plant for the following period
+ *  (preload: new duties latch at the next update).
+ *
+ *  Reports observer convergence time, steady angle error and jitter, d/q
+ *  current tracking, ISR time and how much faster than real time the run went.
+ *
+ *  usage: sim [-t seconds] [-q Lq/Ld] [-n noise_lsb] [-l load_Nm] [-i iq_ref_A]
+ *             [-d id_ref_A] [-s theta_step] [-v vdc] [-k] [-w] [-m] [-z mount] [-c]
+ *             [-y ripple] [-p deg] [-j omega_e] [-x] [-b bw_hz] [-u starts]
+ *             [-h omega_e] [-e|-r] [-o trace.csv]
+ *  -e closes the current loop on the observer angle instead of the open-loop ramp
+ *  -r closes it on the plant rotor angle (an ideal encoder), e.g. -r -i 0.3 -l 0
+ *     accelerates into the voltage limit
+ *  -d/-s open-loop d-axis current and angle step per period (0-4096 per turn);
+ *     -d 1.4 runs close to the CURRENT_LOOP_U_RATIO circle and exercises the current
+ *     sensing near full modulation
+ *  -v bus voltage of the plant; the firmware sees it only through the bus ADC
+ *  -k turns the firmware dead-time compensation off (the plant keeps its
+ *     dead time)
+ *  -w turns field weakening off
+ *  -m runs the motorident self-commissioning first (about 2.4 s, give -t 3)
+ *     and reports the fitted Rs/Ld/Lq/flux against the plant, e.g. -m -t 3 -q 1.5
+ *  -z runs the encoder zero calibration with the encoder mounted mount counts
+ *     off, stepped every 10 ms like MotoTestTask (about 32 s, give -t 33)
+ *  -c runs the encoder nonlinearity learning instead (about 29 s, give -t 30)
+ *     and reports the reading error over a turn with and without the table
+ *  -y adds a once- and twice-per-turn ripple of that many counts to the
+ *     encoder, as an off-axis magnet would, e.g. -c -y 6 -t 30
+ *  -p moves the rotor by deg mechanical with the motion position loop and
+ *     S-curve on the rotor angle (implies -r, Id 0) and reports tracking,
+ *     overshoot and settling, e.g. -p 90 -t 0.5
+ *  -j holds the rotor at omega_e rad/s electrical (a dynamometer), steps
+ *     Iq_ref from 0 to -i (0.1 A if not given) half way through on the
+ *     rotor angle, and compares the step with the decoupling feedforward
+ *     off and on (field weakening off), e.g. -j 600; the ADC noise is 0
+ *     unless -n is given, the 2% settle band is below the default noise.
+ *     A rise that never happens (a step past the voltage limit) or a
+ *     settle that does not hold for the second half of the step prints n/a
+ *  -x turns the decoupling feedforward off
+ *  -b sets the current-loop bandwidth (CurrentLoopSetBandwidth); with -j the
+ *     rise should come out near 2.2/wc, e.g. -j 300 -n 0 -b 400
+ *  -u runs the sensorless start (MotorStartupRun: align, I/F ramp, observer
+ *     check, angle blend) that many times, from rotor angles spread over an
+ *     electrical turn, and reports the time to closed loop of each,
+ *     e.g. -u 8 -t 1
+ *  -h closes the current loop on the high-frequency injection angle
+ *     (FocThetaSource_Hfi, Id 0, Iq -i or 0.1 A), seeded 40 deg off the
+ *     rotor; the firmware is given the plant's Lq as motorident would
+ *     measure it, so it needs -q. omega_e > 0 drives the rotor from a
+ *     dynamometer 0 -> omega_e -> 0 over the run, 0 leaves it free. Angle
+ *     error and torque current are reported for the injection, blend and
+ *     observer speed bands, e.g. -h 800 -q 1.5 -t 2; a band whose error
+ *     goes past SIM_HFI_ERR_FAIL_DEG fails and sim exits 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+#include "host_shim.h"
+#include "foc_host.h"
+#include "plant.h"
+#include "current.h"
+#include "serialplot.h"
+#include "isrprofile.h"
+#include "svpwm.h"
+#include "motordriver.h"
+#include "motorcali.h"
+#include "encoderlinear.h"
+#include "motion.h"
+#include "startup.h"
+#include "hfi.h"
+
+#define SIM_2PI					6.2831853f
+#define SIM_RAD2DEG				57.2957795f
+#define SIM_CONVERGE_TOL_DEG	10.0f
+#define SIM_SETTLE_TOL_DEG		0.1f			//-p: settled within this of the target
+#define SIM_STEP_IQ				0.1f			//-j: default Iq step, A, inside the voltage circle
+#define SIM_STEP_SETTLE			0.02f			//-j: settled within this fraction of the step
+#define SIM_HFI_IQ				0.1f			//-h: default Iq_ref, A
+#define SIM_HFI_SEED_DEG		40.0f			//-h: initial angle error handed to HfiStart
+#define SIM_HFI_SKIP			0.05f			//-h: s of pull-in left out of the band statistics
+#define SIM_HFI_BANDS			3
+#define SIM_HFI_ERR_FAIL_DEG	15.0f			//-h: a band fails past this |angle err| after the pull-in
+#define SIM_TRACE_DECIMATE		10
+#define SIM_TASK_TICK			(PWM_FREQUENCE_VAL/100)		//MotoTestTask runs every 10 ms
+
+static uint16_t simEncoder;
+
+typedef struct{
+	float seconds;
+	float lqOverLd;
+	float noiseLsb;
+	float load;
+	float iqRef;
+	float idRef;
+	uint16_t thetaStep;
+	float vdc;
+	bool deadTimeComp;
+	bool fieldWeakening;
+	bool ident;
+	int32_t zeroMount;
+	bool linear;
+	float ripple;
+	bool move;
+	float moveDeg;
+	float stepOmega;			//-j, 0 = off
+	bool decouple;
+	float bandwidth;			//-b, Hz
+	uint32_t startups;			//-u, 0 = off
+	float startAngle;			//rad electrical, rotor at rest before the start
+	bool hfi;
+	float hfiOmega;				//-h: dynamometer peak, rad/s electrical, 0 = free rotor
+	uint8_t thetaSource;
+	const char *tracePath;
+}SimOption;
+
+typedef struct{
+	PlantParam param;
+	MotorZeroCali zeroCali;
+	EncoderLinearCali linearCali;
+	float moveEnd;				//-p: s, trajectory done
+	float moveSettle;			//s, last time outside SIM_SETTLE_TOL_DEG
+	float moveTrackMax;			//deg, rotor against the trajectory
+	float moveOvershoot;		//deg past the target
+	float moveFinal;			//deg, rotor - target at the end
+	float moveIqMax;
+	float stepRise;				//-j: s, 10-90% of the step in the plant iq
+	float stepSettle;			//s after the step, last time outside SIM_STEP_SETTLE
+	bool stepSettled;			//inside SIM_STEP_SETTLE at the end of the run
+	float stepOvershoot;		//fraction of the step
+	float stepIdMax;			//A, |id| after the step
+	uint8_t startStage;			//-u: MotorStartupStage at the end
+	uint8_t startFailStage;
+	float startClose;			//s, start to handover, <0 not reached
+	float startErr;				//deg, observer - rotor at the handover
+	float startOmegaMin;		//rad/s electrical, rotor from the handover to the end
+	float startOmegaMax;
+	uint32_t hfiN[SIM_HFI_BANDS];	//-h: periods by rotor speed band
+	double hfiErrSum[SIM_HFI_BANDS];	//deg, current-loop angle against the rotor
+	double hfiErrSq[SIM_HFI_BANDS];
+	float hfiErrMax[SIM_HFI_BANDS];
+	double hfiIqSum[SIM_HFI_BANDS];	//A, plant iq (true rotor frame)
+	double hfiIdSum[SIM_HFI_BANDS];	//A, plant id
+	bool hfiStarted;
+	uint32_t periods;
+	float *angleErr;			//deg, one entry per period
+	double idErrSq;				//tail sums for the tracking/speed report
+	double iqErrSq;
+	double omegaSum;
+	uint64_t isrNsSum;
+	uint64_t isrNsMax;
+	uint64_t wallNs;
+	uint32_t plotSent;			//SerialPlotTask frames drained every SERIALPLOT_DRAIN_MS
+	uint32_t shuntGlitch;		//samples taken inside a too-short low-side window
+}SimResult;
+
+static float SimWrapPi(float x)
+{
+	while(x > PI)	x -= SIM_2PI;
+	while(x < -PI)	x += SIM_2PI;
+	return x;
+}
+
+static float SimWrapDeg(float x)
+{
+	return SimWrapPi(x/SIM_RAD2DEG)*SIM_RAD2DEG;
+}
+
+/*
+ * svpwmDri.outPut reverses B/C (MotorRotateReverse_ACB), so a rising vector
+ * turns the rotor backwards; the encoder is mounted to count the same way
+ * the vector turns, as on the gimbal, and reads mount at thetaM = 0.
+ * ripple is the reading error of an off-axis magnet, in counts.
+ */
+static float SimEncoderRipple(float thetaM,float ripple)
+{
+	return ripple*(sinf(thetaM) + 0.3f*sinf(2*thetaM + 1.0f));
+}
+
+static uint16_t SimEncoder(float thetaM,int32_t mount,float ripple)
+{
+	int32_t ppr = focHostMotorCfg.encodePPR;
+	int32_t pos = mount - (int32_t)floorf(thetaM*(ppr/SIM_2PI) + SimEncoderRipple(thetaM,ripple));
+	return ((pos % ppr) + ppr) % ppr;
+}
+
+static void SimParseOption(int argc,char *argv[],SimOption *opt)
+{
+	int c;
+	bool noiseSet = false;
+	opt->seconds = 2.0f;
+	opt->lqOverLd = 1.0f;
+	opt->noiseLsb = 2.0f;
+	opt->load = 0;
+	opt->iqRef = 0;
+	opt->idRef = OPENLOOP_ID_REF;
+	opt->thetaStep = OPENLOOP_THETA_STEP;
+	opt->vdc = VDC_BUS;
+	opt->deadTimeComp = true;
+	opt->fieldWeakening = true;
+	opt->ident = false;
+	opt->zeroMount = -1;
+	opt->linear = false;
+	opt->ripple = 0;
+	opt->move = false;
+	opt->moveDeg = 0;
+	opt->stepOmega = 0;
+	opt->decouple = true;
+	opt->bandwidth = CURRENT_LOOP_BW_HZ;
+	opt->startups = 0;
+	opt->startAngle = 0;
+	opt->hfi = false;
+	opt->hfiOmega = 0;
+	opt->thetaSource = FocThetaSource_OpenLoop;
+	opt->tracePath = NULL;
+	while((c = getopt(argc,argv,"t:q:n:l:i:d:s:v:kwmz:cy:p:j:xb:u:h:ero:")) != -1)
+	{
+		switch(c)
+		{
+			case 't':	opt->seconds = atof(optarg);	break;
+			case 'q':	opt->lqOverLd = atof(optarg);	break;
+			case 'n':	opt->noiseLsb = atof(optarg);	noiseSet = true;	break;
+			case 'l':	opt->load = atof(optarg);		break;
+			case 'i':	opt->iqRef = atof(optarg);		break;
+			case 'd':	opt->idRef = atof(optarg);		break;
+			case 's':	opt->thetaStep = atoi(optarg);	break;
+			case 'v':	opt->vdc = atof(optarg);		break;
+			case 'k':	opt->deadTimeComp = false;	break;
+			case 'w':	opt->fieldWeakening = false;	break;
+			case 'm':	opt->ident = true;				break;
+			case 'z':	opt->zeroMount = atoi(optarg);	break;
+			case 'c':	opt->linear = true;				break;
+			case 'y':	opt->ripple = atof(optarg);		break;
+			case 'p':	opt->move = true;	opt->moveDeg = atof(optarg);	break;
+			case 'j':	opt->stepOmega = atof(optarg);	break;
+			case 'x':	opt->decouple = false;			break;
+			case 'b':	opt->bandwidth = atof(optarg);	break;
+			case 'u':	opt->startups = atoi(optarg);	break;
+			case 'h':	opt->hfi = true;	opt->hfiOmega = atof(optarg);	break;
+			case 'e':	opt->thetaSource = FocThetaSource_Observer;	break;
+			case 'r':	opt->thetaSource = FocThetaSource_External;	break;
+			case 'o':	opt->tracePath = optarg;		break;
+			default:
+				fprintf(stderr,"usage: %s [-t seconds] [-q Lq/Ld] [-n noise_lsb] [-l load_Nm] [-i iq_ref_A] [-d id_ref_A] [-s theta_step] [-v vdc] [-k] [-w] [-m] [-z mount] [-c] [-y ripple] [-p deg] [-j omega_e] [-x] [-b bw_hz] [-u starts] [-h omega_e] [-e|-r] [-o trace.csv]\n",argv[0]);
+				exit(1);
+		}
+	}
+	/* -c without -z: encoder mounted at 0 */
+	if(opt->linear && opt->zeroMount < 0)
+		opt->zeroMount = 0;
+	if(opt->move || opt->stepOmega != 0)
+	{
+		opt->thetaSource = FocThetaSource_External;
+		opt->idRef = 0;
+	}
+	/* -j: field weakening would creep Id in after the step and blur the settle */
+	if(opt->stepOmega != 0)
+		opt->fieldWeakening = false;
+	if(opt->stepOmega != 0 && opt->iqRef == 0)
+		opt->iqRef = SIM_STEP_IQ;
+	if(opt->stepOmega != 0 && !noiseSet)
+		opt->noiseLsb = 0;
+	if(opt->hfi)
+	{
+		opt->thetaSource = FocThetaSource_Hfi;
+		opt->idRef = 0;
+		if(opt->iqRef == 0)
+			opt->iqRef = SIM_HFI_IQ;
+	}
+}
+
+/*
+ * -p: the trajectory counts as started once motion has planned it, and as
+ * done when it has landed on the target; overshoot is signed along the move.
+ */
+static void SimMoveTrack(const SimOption *opt,SimResult *res,float posDeg,float t)
+{
+	const MotionTraj *tr = &motor_motion.traj;
+	float err = posDeg - opt->moveDeg;
+	float over = opt->moveDeg >= 0 ? err : -err;
+
+	if(tr->Busy && fabsf(posDeg - tr->Pos*SIM_RAD2DEG) > res->moveTrackMax)
+		res->moveTrackMax = fabsf(posDeg - tr->Pos*SIM_RAD2DEG);
+	if(!tr->Busy && !motor_motion.MovePending && res->moveEnd < 0)
+		res->moveEnd = t;
+	if(over > res->moveOvershoot)
+		res->moveOvershoot = over;
+	if(fabsf(err) > SIM_SETTLE_TOL_DEG)
+		res->moveSettle = t;
+	if(fabsf(motor_foc.Iq_ref) > res->moveIqMax)
+		res->moveIqMax = fabsf(motor_foc.Iq_ref);
+	res->moveFinal = err;
+}
+
+/*
+ * -j: rise and overshoot on the plant's own iq, id is the cross-coupling
+ * the step kicks into the d axis
+ */
+static void SimStepTrack(const SimOption *opt,SimResult *res,const Plant *plant,float t,float *t10)
+{
+	float amp = opt->iqRef;
+
+	if(*t10 < 0 && plant->iq >= 0.1f*amp)
+		*t10 = t;
+	if(res->stepRise < 0 && plant->iq >= 0.9f*amp)
+		res->stepRise = t - *t10;
+	if((plant->iq - amp)/amp > res->stepOvershoot)
+		res->stepOvershoot = (plant->iq - amp)/amp;
+	res->stepSettled = fabsf(plant->iq - amp) <= SIM_STEP_SETTLE*amp;
+	if(!res->stepSettled)
+		res->stepSettle = t;
+	if(fabsf(plant->id) > res->stepIdMax)
+		res->stepIdMax = fabsf(plant->id);
+}
+
+/*
+ * -h: bands by the rotor's own speed, below HFI_W_LOW, the blend, above
+ * HFI_W_HIGH; plant id/iq are means, the injected ripple averages out
+ */
+static void SimHfiTrack(SimResult *res,const Plant *plant,float errDeg)
+{
+	float w = fabsf(PlantOmegaE(plant));
+	uint8_t b = w < HFI_W_LOW ? 0 : w < HFI_W_HIGH ? 1 : 2;
+
+	res->hfiN[b]++;
+	res->hfiErrSum[b] += errDeg;
+	res->hfiErrSq[b] += errDeg*errDeg;
+	if(fabsf(errDeg) > res->hfiErrMax[b])
+		res->hfiErrMax[b] = fabsf(errDeg);
+	res->hfiIqSum[b] += plant->iq;
+	res->hfiIdSum[b] += plant->id;
+}
+
+static void SimRun(const SimOption *opt,SimResult *res)
+{
+	PlantParam param;
+	Plant plant;
+	FILE *trace = NULL;
+	uint32_t ccr[3],arr;
+	uint16_t sample[ADC_SAMPLE_NUM];
+	float dt = 1.0f/PWM_FREQUENCE_VAL;
+	float moveTarget = opt->moveDeg/SIM_RAD2DEG,thetaM0 = 0;
+	float stepT0 = opt->seconds/2,stepT10 = -1;
+	uint64_t wallStart;
+
+	PlantDefaultParam(&param);
+	param.Lq = param.Ld*opt->lqOverLd;
+	param.adcNoiseLsb = opt->noiseLsb;
+	param.Vdc = opt->vdc;
+	PlantInit(&plant,&param);
+	res->param = param;
+	plant.loadTorque = opt->load;
+
+	FocHostInit();
+	motor_foc.Iq_ref = opt->iqRef;
+	motor_foc.Id_ref = opt->idRef;
+	motor_foc.ThetaStep = opt->thetaStep;
+	motor_dtc.Enable = opt->deadTimeComp;
+	motor_foc.fw.Enable = opt->fieldWeakening;
+	motor_foc.ThetaSource = opt->thetaSource;
+	motor_foc.Decouple = opt->decouple;
+	CurrentLoopSetBandwidth(opt->bandwidth);
+	if(opt->hfi)
+	{
+		motor.Motor_Lq_pu = param.Lq;
+		MotorParamUpdate();
+	}
+
+	/* ADC offset calibration runs on the real plant with the bridge idle */
+	while(!adc_result.haszero)
+	{
+		PlantAdcSample(&plant,sample,adc_result.shunt_next);
+		HostAdvanceMicro(FOC_HOST_PWM_PERIOD_US);
+		ISR_PROFILE_BEGIN();
+		CurrentRunning(0,sample);
+		PlantStep(&plant,dt);
+	}
+
+	res->periods = opt->seconds*PWM_FREQUENCE_VAL;
+	res->angleErr = malloc(sizeof(float)*res->periods);
+	res->isrNsSum = 0;
+	res->isrNsMax = 0;
+	res->idErrSq = 0;
+	res->iqErrSq = 0;
+	res->omegaSum = 0;
+	res->plotSent = 0;
+	plant.shuntGlitch = 0;
+	clPlotBuff.drop = 0;
+	if(opt->ident)
+		MotorIdentStart(&motor_ident);
+	if(opt->zeroMount >= 0 || opt->linear)
+	{
+		focHostMotorCfg.GetEncoderAddr = &simEncoder;
+		focHostMotorCfg.encodeZeroPos = 0;
+		if(opt->linear)
+			EncoderLinearCaliStart(&res->linearCali,svpwmID,&focHostMotorCfg);
+		else
+			MotorZeroCaliStart(&res->zeroCali,svpwmID,&focHostMotorCfg,focHostMotorCfg.pole);
+	}
+	if(opt->stepOmega != 0)
+	{
+		plant.omegaM = opt->stepOmega/param.polePairs;
+		plant.speedHold = true;
+		motor_foc.Iq_ref = 0;
+		res->stepRise = -1;
+		res->stepSettle = 0;
+		res->stepSettled = false;
+		res->stepOvershoot = 0;
+		res->stepIdMax = 0;
+	}
+	if(opt->move)
+	{
+		motor_foc.Theta = ((int32_t)(plant.thetaE*(SvpwmDriverRad/SIM_2PI))) & SvpwmDriverRad_mask;
+		thetaM0 = plant.thetaM;
+		MotionMove(&motor_motion,moveTarget);
+		res->moveEnd = -1;
+		res->moveSettle = 0;
+		res->moveTrackMax = 0;
+		res->moveOvershoot = 0;
+		res->moveIqMax = 0;
+	}
+	if(opt->startups != 0)
+	{
+		plant.thetaE = opt->startAngle;
+		plant.thetaM = opt->startAngle/param.polePairs;
+		plant.sinE = sinf(plant.thetaE);
+		plant.cosE = cosf(plant.thetaE);
+		MotorStartupStart(&motor_startup);
+		res->startClose = -1;
+		res->startErr = 0;
+	}
+	if(opt->hfi)
+	{
+		motor_foc.Theta = ((int32_t)((plant.thetaE + SIM_HFI_SEED_DEG/SIM_RAD2DEG)*(SvpwmDriverRad/SIM_2PI))) & SvpwmDriverRad_mask;
+		res->hfiStarted = HfiStart(&motor_hfi);
+		for(uint8_t i = 0;i<SIM_HFI_BANDS;i++)
+		{
+			res->hfiN[i] = 0;
+			res->hfiErrSum[i] = 0;
+			res->hfiErrSq[i] = 0;
+			res->hfiErrMax[i] = 0;
+			res->hfiIqSum[i] = 0;
+			res->hfiIdSum[i] = 0;
+		}
+		plant.speedHold = opt->hfiOmega != 0;
+	}
+	if(opt->tracePath != NULL)
+	{
+		trace = fopen(opt->tracePath,"w");
+		if(trace != NULL)
+			fprintf(trace,"t,theta_e,theta_est,omega_e,ia,ib,va,vb,vc\n");
+	}
+
+	wallStart = HostNanos();
+	for(uint32_t k = 0;k<res->periods;k++)
+	{
+		uint64_t isrStart,isrNs;
+
+		PlantAdcSample(&plant,sample,adc_result.shunt_next);
+		HostAdvanceMicro(FOC_HOST_PWM_PERIOD_US);
+		if(opt->zeroMount >= 0 || opt->linear)
+		{
+			simEncoder = SimEncoder(plant.thetaM,opt->zeroMount,opt->ripple);
+			if((k % SIM_TASK_TICK) == 0)
+			{
+				if(opt->linear)
+					EncoderLinearCaliStep(&res->linearCali);
+				else
+					MotorZeroCaliStep(&res->zeroCali);
+			}
+		}
+		if(opt->thetaSource == FocThetaSource_External)
+			motor_foc.Theta = ((int32_t)(plant.thetaE*(SvpwmDriverRad/SIM_2PI))) & SvpwmDriverRad_mask;
+		if(plant.speedHold && opt->hfi)
+			plant.omegaM = opt->hfiOmega*(1 - fabsf(2.0f*k/res->periods - 1))/param.polePairs;
+		isrStart = HostNanos();
+		ISR_PROFILE_BEGIN();
+		CurrentRunning(0,sample);
+		isrNs = HostNanos() - isrStart;
+		res->isrNsSum += isrNs;
+		if(isrNs > res->isrNsMax)
+			res->isrNsMax = isrNs;
+
+		if(opt->hfi)
+		{
+			res->angleErr[k] = SimWrapPi(motor_foc.Theta*(SIM_2PI/SvpwmDriverRad) - plant.thetaE)*SIM_RAD2DEG;
+			if(k*dt >= SIM_HFI_SKIP)
+				SimHfiTrack(res,&plant,res->angleErr[k]);
+		}else
+			res->angleErr[k] = SimWrapPi(motor_Estimate.Theta_comp - plant.thetaE)*SIM_RAD2DEG;
+		if(opt->stepOmega != 0 && k*dt >= stepT0)
+		{
+			motor_foc.Iq_ref = opt->iqRef;
+			SimStepTrack(opt,res,&plant,k*dt - stepT0,&stepT10);
+		}
+		if(opt->move)
+			SimMoveTrack(opt,res,(plant.thetaM - thetaM0)*SIM_RAD2DEG,k*dt);
+		if(opt->startups != 0 && motor_startup.Stage == MotorStartupStage_Done)
+		{
+			float w = PlantOmegaE(&plant);
+			if(res->startClose < 0)
+			{
+				res->startClose = motor_startup.CloseTicks*dt;
+				res->startErr = res->angleErr[k];
+				res->startOmegaMin = res->startOmegaMax = w;
+			}
+			if(w < res->startOmegaMin)
+				res->startOmegaMin = w;
+			if(w > res->startOmegaMax)
+				res->startOmegaMax = w;
+		}
+		if(k >= res->periods - res->periods/4)
+		{
+			double ed = motor_foc.Id_ref + motor_foc.fw.Id - motor_foc.Id_fbk;
+			double eq = motor_foc.Iq_ref - motor_foc.Iq_fbk;
+			res->idErrSq += ed*ed;
+			res->iqErrSq += eq*eq;
+			res->omegaSum += PlantOmegaE(&plant);
+		}
+		if(trace != NULL && (k % SIM_TRACE_DECIMATE) == 0)
+		{
+			fprintf(trace,"%f,%f,%f,%f,%f,%f,%f,%f,%f\n",k*dt,plant.thetaE,motor_Estimate.Theta_comp,
+					PlantOmegaE(&plant),plant.ia,plant.ib,plant.va,plant.vb,plant.vc);
+		}
+
+		if((k % (SERIALPLOT_DRAIN_MS*PWM_FREQUENCE_VAL/1000)) == 0)
+			res->plotSent += SerialPlotRingDrain();
+
+		FocHostReadCcr(ccr,&arr);
+		PlantApplyCcr(&plant,ccr[0],ccr[1],ccr[2],arr);
+		PlantStep(&plant,dt);
+	}
+	res->wallNs = HostNanos() - wallStart;
+	res->startStage = motor_startup.Stage;
+	res->startFailStage = motor_startup.FailStage;
+	res->shuntGlitch = plant.shuntGlitch;
+	if(trace != NULL)
+		fclose(trace);
+}
+
+/* isrprofile stages, in host TSC ticks rather than target cycles */
+static void SimReportProfile(void)
+{
+	static const char *name[IsrStage_Num] = {"dma","sample","observer","modulation","ccr","total"};
+	IsrProfileStage st;
+	uint32_t overrun;
+
+	printf("ISR stages (host ticks)  %8s %8s %8s  log2 histogram\n","min","mean","max");
+	for(uint8_t i = 0;i<IsrStage_Num;i++)
+	{
+		if(!IsrProfileSnapshot(i,&st,&overrun))
+			continue;
+		printf("  %-22s %8u %8.0f %8u  ",name[i],st.Min,(double)st.Sum/st.Count,st.Max);
+		for(uint8_t b = 0;b<ISR_PROFILE_HIST_BINS;b++)
+			printf(b ? ",%u" : "%u",st.Hist[b]);
+		printf("\n");
+	}
+}
+
+static void SimReportIdentParam(const char *name,const char *unit,float fit,float plant)
+{
+	printf("  %-20s %8.4f %s (plant %.4f, %+.1f%%)\n",name,fit,unit,plant,100*(fit - plant)/plant);
+}
+
+static void SimReportIdent(const SimResult *res)
+{
+	static const char *stage[] = {"idle","ramp","align","Rs","Ld","Lq","spin-up","coast","done","fail"};
+
+	if(motor_ident.Stage == MotorIdentStage_Fail)
+	{
+		printf("identification         failed in %s, fit %.3f\n",stage[motor_ident.FailStage],motor_ident.Fit);
+		return;
+	}
+	if(motor_ident.Stage != MotorIdentStage_Done)
+	{
+		printf("identification         still in %s, run longer\n",stage[motor_ident.Stage]);
+		return;
+	}
+	printf("identification         done, test voltage %.2f V\n",motor_ident.UTest);
+	SimReportIdentParam("Rs","ohm",motor.Motor_Rs_pu,res->param.Rs);
+	SimReportIdentParam("Ld","mH",motor.Motor_Ld_pu*1000,res->param.Ld*1000);
+	SimReportIdentParam("Lq","mH",motor.Motor_Lq_pu*1000,res->param.Lq*1000);
+	SimReportIdentParam("flux","mWb",motor.Motor_Flux*1000,res->param.flux*1000);
+}
+
+/*
+ * The rotor locks at thetaE = -vector, so the closed-loop mapping
+ * (pos + zero)*pole/PPR lands on it for zero = -mount modulo PPR/pole.
+ */
+static void SimReportZeroCali(const SimOption *opt,const SimResult *res)
+{
+	const MotorZeroCali *mzc = &res->zeroCali;
+	float period = (float)focHostMotorCfg.encodePPR/focHostMotorCfg.pole;
+	float expect = fmodf(-opt->zeroMount,period);
+	float errDeg;
+
+	if(expect < 0)
+		expect += period;
+	if(mzc->Stage != MotorZeroCaliStage_Done)
+	{
+		printf("encoder zero           %s\n",mzc->Stage == MotorZeroCaliStage_Fail ? "failed" : "not finished, run longer");
+		return;
+	}
+	errDeg = SimWrapDeg((mzc->ZeroPos - expect)*360.0f/period);
+	printf("encoder zero           %u counts (expect %.2f, %+.2f deg electrical), hysteresis %.2f deg\n",
+			mzc->ZeroPos,expect,errDeg,mzc->Hysteresis*360.0f/SvpwmDriverRad);
+}
+
+/*
+ * Reading error over one turn against the ripple-free position, raw and
+ * with the learned table applied the way SvpwmGenerate applies it. The
+ * constant part (mount, the 1/2 count of floor) is taken out of both.
+ */
+static void SimLinearErr(const SimOption *opt,const EncoderLinear *el,float thetaM,float *err)
+{
+	float ppr = focHostMotorCfg.encodePPR;
+	uint16_t pos = SimEncoder(thetaM,opt->zeroMount,opt->ripple);
+	float ideal = opt->zeroMount - thetaM*(ppr/SIM_2PI);
+
+	err[0] = remainderf(pos - ideal,ppr);
+	err[1] = remainderf(pos + EncoderLinearCorrect(el,pos)*(1.0f/(1<<ENCODER_LINEAR_FRAC)) - ideal,ppr);
+}
+
+static void SimReportLinear(const SimOption *opt,const SimResult *res)
+{
+	const EncoderLinearCali *elc = &res->linearCali;
+	const uint32_t n = 4*focHostMotorCfg.encodePPR;
+	double sum[2] = {0},sum2[2] = {0};
+	float peak[2] = {0};
+	float err[2];
+	EncoderLinear el;
+
+	if(elc->Stage != EncoderLinearCaliStage_Done)
+	{
+		printf("encoder linearity      %s\n",elc->Stage == EncoderLinearCaliStage_Fail ? "failed" : "not finished, run longer");
+		return;
+	}
+	EncoderLinearSetPPR(&el,focHostMotorCfg.encodePPR);
+	EncoderLinearSet(&el,elc->Correct);
+	for(uint32_t i = 0;i<n;i++)
+	{
+		SimLinearErr(opt,&el,i*SIM_2PI/n,err);
+		for(uint8_t j = 0;j<2;j++)
+		{
+			sum[j] += err[j];
+			sum2[j] += err[j]*err[j];
+		}
+	}
+	for(uint32_t i = 0;i<n;i++)
+	{
+		SimLinearErr(opt,&el,i*SIM_2PI/n,err);
+		for(uint8_t j = 0;j<2;j++)
+			if(fabsf(err[j] - sum[j]/n) > peak[j])
+				peak[j] = fabsf(err[j] - sum[j]/n);
+	}
+	printf("encoder linearity      table peak %.2f counts\n",elc->Peak*(1.0f/(1<<ENCODER_LINEAR_FRAC)));
+	for(uint8_t j = 0;j<2;j++)
+	{
+		float rms = sqrt(sum2[j]/n - (sum[j]/n)*(sum[j]/n));
+		printf("  %-20s %.2f counts rms, %.2f peak (%.2f deg electrical peak)\n",j ? "corrected" : "raw",
+				rms,peak[j],peak[j]*focHostMotorCfg.pole*360/focHostMotorCfg.encodePPR);
+	}
+}
+
+static void SimReportMove(const SimOption *opt,const SimResult *res)
+{
+	printf("position move          %.2f deg, S-curve %.1f ms, settled (%.2f deg) at %.1f ms\n",opt->moveDeg,
+			res->moveEnd*1000,SIM_SETTLE_TOL_DEG,res->moveSettle*1000);
+	printf("  tracking error max   %.3f deg\n",res->moveTrackMax);
+	printf("  overshoot            %.3f deg\n",res->moveOvershoot);
+	printf("  final error          %+.3f deg\n",res->moveFinal);
+	printf("  |Iq_ref| max         %.3f A\n",res->moveIqMax);
+}
+
+/* rise/settle column, n/a when the step never got there */
+static void SimReportStepTime(float t,bool valid)
+{
+	if(valid)
+		printf("   %7.1f us",t*1e6);
+	else
+		printf("   %7s   ","n/a");
+}
+
+static void SimReportStep(const SimOption *opt,const SimResult res[2])
+{
+	float wc = motor_foc.pi_q.Kp/motor.Motor_Lq_pu;
+
+	printf("Iq step 0 -> %.2f A at %.0f rad/s electrical (held), Vbus %.1f V, ADC noise %.1f LSB\n",opt->iqRef,
+			opt->stepOmega,opt->vdc,opt->noiseLsb);
+	printf("  current loop %.0f Hz, crossover %.0f Hz after the delay limit, 2.2/wc %.1f us\n",motor_foc.Bandwidth,
+			wc/(2*PI),2.2f/wc*1e6);
+	printf("  decoupling     rise 10-90%%   settle %.0f%%   overshoot   |Id| max\n",SIM_STEP_SETTLE*100);
+	for(uint8_t i = 0;i<2;i++)
+	{
+		printf("  %-10s  ",i ? "on" : "off");
+		SimReportStepTime(res[i].stepRise,res[i].stepRise >= 0);
+		SimReportStepTime(res[i].stepSettle,res[i].stepSettled && res[i].stepSettle < opt->seconds/4);
+		printf("   %7.1f%%   %6.3f A\n",res[i].stepOvershoot*100,res[i].stepIdMax);
+	}
+}
+
+/* false when a speed band lost the rotor by more than SIM_HFI_ERR_FAIL_DEG */
+static bool SimReportHfi(const SimOption *opt,const SimResult *res)
+{
+	static const char *band[SIM_HFI_BANDS] = {"injection","blend","observer"};
+	bool ok = true;
+
+	if(!res->hfiStarted)
+	{
+		printf("HFI                    not started, Lq/Ld %.2f is under the %.0f%% saliency it needs (give -q)\n",
+				opt->lqOverLd,HFI_SALIENCY_MIN*100);
+		return true;
+	}
+	printf("HFI                    %.2f V at %u Hz, tracking %.0f Hz, blend %.0f..%.0f rad/s, %s\n",motor_hfi.Uh,
+			PWM_FREQUENCE_VAL/2,HFI_PLL_BW_HZ,HFI_W_LOW,HFI_W_HIGH,
+			opt->hfiOmega != 0 ? "dynamometer sweep" : "free rotor");
+	printf("  band        periods   angle err mean    rms     max   plant id    iq (ref %.2f A)   (fail > %.0f deg)\n",
+			opt->iqRef,SIM_HFI_ERR_FAIL_DEG);
+	for(uint8_t b = 0;b<SIM_HFI_BANDS;b++)
+	{
+		uint32_t n = res->hfiN[b];
+		if(n == 0)
+		{
+			printf("  %-10s  %7u\n",band[b],n);
+			continue;
+		}
+		printf("  %-10s  %7u   %+8.2f  %7.2f %7.2f   %+7.4f   %+7.4f   %s\n",band[b],n,res->hfiErrSum[b]/n,
+				sqrt(res->hfiErrSq[b]/n),res->hfiErrMax[b],res->hfiIdSum[b]/n,res->hfiIqSum[b]/n,
+				res->hfiErrMax[b] > SIM_HFI_ERR_FAIL_DEG ? "FAIL" : "ok");
+		if(res->hfiErrMax[b] > SIM_HFI_ERR_FAIL_DEG)
+			ok = false;
+	}
+	return ok;
+}
+
+static void SimReportStartup(const SimOption *opt,const SimResult *res)
+{
+	uint32_t closed = 0;
+	float tMin = 0,tMax = 0,tSum = 0;
+
+	printf("sensorless start, I/F %.2f A at %.0f rad/s^2 to %.0f rad/s electrical, load %.4f Nm\n",
+			motor_startup.Current,motor_startup.Acc,motor_startup.OmegaEnd,opt->load);
+	printf("  rotor at   result   closed loop   handover err   speed after (rad/s)\n");
+	for(uint32_t i = 0;i<opt->startups;i++)
+	{
+		const SimResult *r = &res[i];
+		float deg = 360.0f*i/opt->startups;
+		if(r->startClose < 0)
+		{
+			printf("  %5.1f deg  fail %u\n",deg,r->startStage == MotorStartupStage_Fail ? r->startFailStage : r->startStage);
+			continue;
+		}
+		printf("  %5.1f deg  ok      %7.1f ms     %+7.2f deg    %6.1f .. %6.1f\n",deg,r->startClose*1000,
+				r->startErr,r->startOmegaMin,r->startOmegaMax);
+		if(closed == 0 || r->startClose < tMin)
+			tMin = r->startClose;
+		if(closed == 0 || r->startClose > tMax)
+			tMax = r->startClose;
+		tSum += r->startClose;
+		closed++;
+	}
+	printf("  closed loop in %u of %u",closed,opt->startups);
+	if(closed != 0)
+		printf(", time to closed loop min %.1f mean %.1f max %.1f ms",tMin*1000,tSum/closed*1000,tMax*1000);
+	printf("\n");
+}
+
+/*
+ * Steady error is the circular mean of the last quarter of the run; the
+ * observer counts as converged from the last period whose error was further
+ * than SIM_CONVERGE_TOL_DEG from it. Returns false when a pass/fail check failed.
+ */
+static bool SimReport(const SimOption *opt,const SimResult *res)
+{
+	bool ok = true;
+	uint32_t tail = res->periods - res->periods/4;
+	double s = 0,c = 0,mean,var = 0;
+	int64_t lastOut = -1;
+
+	for(uint32_t k = tail;k<res->periods;k++)
+	{
+		s += sin(res->angleErr[k]/SIM_RAD2DEG);
+		c += cos(res->angleErr[k]/SIM_RAD2DEG);
+	}
+	mean = atan2(s,c)*SIM_RAD2DEG;
+	for(uint32_t k = tail;k<res->periods;k++)
+	{
+		double e = SimWrapDeg(res->angleErr[k] - mean);
+		var += e*e;
+	}
+	var /= (res->periods - tail);
+	for(uint32_t k = 0;k<res->periods;k++)
+	{
+		if(fabsf(SimWrapDeg(res->angleErr[k] - mean)) > SIM_CONVERGE_TOL_DEG)
+			lastOut = k;
+	}
+
+	printf("simulated              %.3f s (%u periods at %u Hz)\n",opt->seconds,res->periods,PWM_FREQUENCE_VAL);
+	printf("Lq/Ld                  %.2f\n",opt->lqOverLd);
+	printf("bus voltage            %.2f V, filtered %.2f V\n",opt->vdc,motor_fbk.Vbus);
+	printf("dead-time compensation %s\n",opt->deadTimeComp ? "on" : "off");
+	printf("current loop angle     %s\n",opt->thetaSource == FocThetaSource_Observer ? "observer" :
+			opt->thetaSource == FocThetaSource_External ? "rotor (encoder)" :
+			opt->thetaSource == FocThetaSource_Hfi ? "high-frequency injection" : "open-loop ramp");
+	printf("steady angle error     %.2f deg\n",mean);
+	printf("angle jitter (rms)     %.2f deg\n",sqrt(var));
+	if(lastOut + 1 >= (int64_t)tail)
+		printf("observer convergence   not converged within %.0f deg\n",SIM_CONVERGE_TOL_DEG);
+	else
+		printf("observer convergence   %.2f ms\n",(lastOut + 1)*1000.0/PWM_FREQUENCE_VAL);
+	printf("mean speed             %.1f rad/s electrical\n",res->omegaSum/(res->periods - tail));
+	printf("Id tracking (rms)      %.4f A (ref %.2f A)\n",sqrt(res->idErrSq/(res->periods - tail)),motor_foc.Id_ref);
+	printf("field weakening        %s, Id %.3f A\n",opt->fieldWeakening ? "on" : "off",motor_foc.fw.Id);
+	printf("Iq tracking (rms)      %.4f A (ref %.2f A)\n",sqrt(res->iqErrSq/(res->periods - tail)),motor_foc.Iq_ref);
+	printf("current sensing        %s, %u of %u samples in a short low-side window\n",
+			CURRENT_THREE_SHUNT ? "three-shunt" : "two-shunt",res->shuntGlitch,2*res->periods);
+	printf("telemetry frames       %u sent, %u dropped\n",res->plotSent,clPlotBuff.drop);
+	printf("loop latency           1 period sample->duty (%u us) + ISR\n",FOC_HOST_PWM_PERIOD_US);
+	printf("ISR host time          mean %.1f ns, max %llu ns\n",(double)res->isrNsSum/res->periods,(unsigned long long)res->isrNsMax);
+	printf("real-time factor       %.0fx\n",opt->seconds*1e9/res->wallNs);
+	if(opt->ident)
+		SimReportIdent(res);
+	if(opt->move)
+		SimReportMove(opt,res);
+	if(opt->hfi)
+		ok = SimReportHfi(opt,res);
+	if(opt->linear)
+		SimReportLinear(opt,res);
+	else if(opt->zeroMount >= 0)
+		SimReportZeroCali(opt,res);
+	SimReportProfile();
+	return ok;
+}
+
+int main(int argc,char *argv[])
+{
+	SimOption opt;
+	SimResult res;
+	bool ok;
+
+	SimParseOption(argc,argv,&opt);
+	if(opt.startups != 0)
+	{
+		SimResult *start = calloc(opt.startups,sizeof(SimResult));
+		for(uint32_t i = 0;i<opt.startups;i++)
+		{
+			opt.startAngle = SIM_2PI*i/opt.startups;
+			SimRun(&opt,&start[i]);
+			free(start[i].angleErr);
+		}
+		SimReportStartup(&opt,start);
+		free(start);
+		return 0;
+	}
+	if(opt.stepOmega != 0)
+	{
+		SimResult step[2];
+		for(uint8_t i = 0;i<2;i++)
+		{
+			opt.decouple = i;
+			SimRun(&opt,&step[i]);
+			free(step[i].angleErr);
+		}
+		SimReportStep(&opt,step);
+		return 0;
+	}
+	SimRun(&opt,&res);
+	ok = SimReport(&opt,&res);
+	free(res.angleErr);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+ * trig.c
+ *
+ *  Host benchmark of the myMath trigonometry kernels against libm: time per
+ *  call (ns and TSC ticks) and max/rms error over a full-turn sweep.
+ *  Absolute timings are host numbers; use them to rank kernels, not to
+ *  predict target cycles.
+ *
+ *  usage: trig [-n iterations] [-o curve.csv]
+ *  -o writes the error curve of every kernel over one turn.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRIG_TICKS()	__rdtsc()
+#else
+#define TRIG_TICKS()	0
+#endif
+#include "host_shim.h"
+#include "myMath.h"
+
+#define TRIG_ITERATIONS_DEFAULT		4000000u
+#define TRIG_TABLE_SIZE				4096u
+#define TRIG_SWEEP					65536u
+#define TRIG_2PI					6.283185307179586
+
+typedef struct{
+	const char	*name;
+	const char	*unit;
+	void		(*run)(uint32_t i);
+	double		(*error)(double turn);		//误差,turn为0-1一圈
+}TrigCase;
+
+static float				trigRad[TRIG_TABLE_SIZE];
+static int32_t				trigXQ15[TRIG_TABLE_SIZE];
+static int32_t				trigYQ15[TRIG_TABLE_SIZE];
+static volatile float		trigSinkf;
+static volatile int32_t		trigSink;
+
+static double TrigWrapPi(double x)
+{
+	while(x > M_PI)		x -= TRIG_2PI;
+	while(x < -M_PI)	x += TRIG_2PI;
+	return x;
+}
+
+static void RunSinf(uint32_t i)			{ trigSinkf = sinf(trigRad[i & (TRIG_TABLE_SIZE-1)]); }
+static void RunSinFast(uint32_t i)		{ trigSinkf = SinFast(trigRad[i & (TRIG_TABLE_SIZE-1)]); }
+static void RunSinCosFast(uint32_t i)
+{
+	float s,c;
+	SinCosFast(trigRad[i & (TRIG_TABLE_SIZE-1)],&s,&c);
+	trigSinkf = s + c;
+}
+static void RunSinQ15(uint32_t i)		{ trigSink = SinQ15(i); }
+static void RunSinCosQ15(uint32_t i)
+{
+	Q15 s,c;
+	SinCosQ15(i,&s,&c);
+	trigSink = s + c;
+}
+static void RunSinCosQ15Fine(uint32_t i)
+{
+	Q15 s,c;
+	SinCosQ15Fine(i*7,&s,&c);
+	trigSink = s + c;
+}
+static void RunAtan2f(uint32_t i)
+{
+	uint32_t k = i & (TRIG_TABLE_SIZE-1);
+	trigSinkf = atan2f(trigYQ15[k],trigXQ15[k]);
+}
+static void RunAtan2Fast(uint32_t i)
+{
+	uint32_t k = i & (TRIG_TABLE_SIZE-1);
+	trigSinkf = Atan2Fast(trigYQ15[k],trigXQ15[k]);
+}
+static void RunAtan2Q12(uint32_t i)
+{
+	uint32_t k = i & (TRIG_TABLE_SIZE-1);
+	trigSink = Atan2Q12(trigYQ15[k],trigXQ15[k]);
+}
+
+/* errors: float kernels in absolute units, Q15 in LSB, Q12 angles in steps */
+static double ErrSinFast(double t)		{ return SinFast(t*TRIG_2PI - 2*TRIG_2PI) - sin(t*TRIG_2PI); }
+static double ErrCosFast(double t)		{ return CosFast(t*TRIG_2PI + TRIG_2PI) - cos(t*TRIG_2PI); }
+static double ErrSinCosFast(double t)
+{
+	float s,c;
+	SinCosFast(t*TRIG_2PI,&s,&c);
+	return fmax(fabs(s - sin(t*TRIG_2PI)),fabs(c - cos(t*TRIG_2PI)));
+}
+static double ErrSinQ15(double t)
+{
+	/* angle input is 4096 steps: compare at the step the caller asked for */
+	uint16_t a = (uint16_t)(t*VALUE_Q12);
+	return SinQ15(a) - VALUE_Q15*sin(a*TRIG_2PI/VALUE_Q12);
+}
+static double ErrCosQ15(double t)
+{
+	uint16_t a = (uint16_t)(t*VALUE_Q12);
+	return CosQ15(a) - VALUE_Q15*cos(a*TRIG_2PI/VALUE_Q12);
+}
+static double ErrSinCosQ15Fine(double t)
+{
+	uint16_t a = (uint16_t)(t*VALUE_Q16);
+	Q15 s,c;
+	SinCosQ15Fine(a,&s,&c);
+	return fmax(fabs(s - VALUE_Q15*sin(a*TRIG_2PI/VALUE_Q16)),fabs(c - VALUE_Q15*cos(a*TRIG_2PI/VALUE_Q16)));
+}
+static double ErrAtan2Fast(double t)
+{
+	double r = 1e-3 + t*1000;
+	return TrigWrapPi(Atan2Fast(r*sin(t*TRIG_2PI),r*cos(t*TRIG_2PI)) - TrigWrapPi(t*TRIG_2PI));
+}
+static double ErrAtan2Q12(double t)
+{
+	/* small vectors on purpose: the observer back-EMF can be a few LSB */
+	double r = 16 + t*VALUE_Q24;
+	double e = Atan2Q12(lround(r*sin(t*TRIG_2PI)),lround(r*cos(t*TRIG_2PI))) - t*VALUE_Q12;
+	while(e > VALUE_Q12/2)	e -= VALUE_Q12;
+	while(e < -VALUE_Q12/2)	e += VALUE_Q12;
+	return e;
+}
+
+static const TrigCase trigCase[] = {
+	{"sinf (libm)",		"",		RunSinf,			NULL},
+	{"SinFast",			"",		RunSinFast,			ErrSinFast},
+	{"CosFast",			"",		RunSinFast,			ErrCosFast},
+	{"SinCosFast",		"",		RunSinCosFast,		ErrSinCosFast},
+	{"SinQ15",			"LSB",	RunSinQ15,			ErrSinQ15},
+	{"CosQ15",			"LSB",	RunSinQ15,			ErrCosQ15},
+	{"SinCosQ15",		"LSB",	RunSinCosQ15,		NULL},
+	{"SinCosQ15Fine",	"LSB",	RunSinCosQ15Fine,	ErrSinCosQ15Fine},
+	{"atan2f (libm)",	"rad",	RunAtan2f,			NULL},
+	{"Atan2Fast",		"rad",	RunAtan2Fast,		ErrAtan2Fast},
+	{"Atan2Q12",		"step",	RunAtan2Q12,		ErrAtan2Q12},
+};
+
+static void TrigTableInit(void)
+{
+	for(uint32_t i = 0;i<TRIG_TABLE_SIZE;i++)
+	{
+		double t = (double)i*7/TRIG_TABLE_SIZE;
+		trigRad[i] = (t - 3.5)*TRIG_2PI;
+		trigXQ15[i] = lround((100 + 30*i)*cos(t*TRIG_2PI));
+		trigYQ15[i] = lround((100 + 30*i)*sin(t*TRIG_2PI));
+	}
+}
+
+int main(int argc,char *argv[])
+{
+	uint32_t iterations = TRIG_ITERATIONS_DEFAULT;
+	const char *curvePath = NULL;
+	FILE *curve = NULL;
+	int c;
+
+	while((c = getopt(argc,argv,"n:o:")) != -1)
+	{
+		switch(c)
+		{
+			case 'n':	iterations = strtoul(optarg,NULL,0);	break;
+			case 'o':	curvePath = optarg;						break;
+			default:
+				fprintf(stderr,"usage: %s [-n iterations] [-o curve.csv]\n",argv[0]);
+				return 1;
+		}
+	}
+	if(iterations == 0)
+		iterations = TRIG_ITERATIONS_DEFAULT;
+	TrigTableInit();
+
+	printf("%-16s %10s %10s %14s %14s\n","kernel","ns/call","ticks","max |err|","rms err");
+	for(uint8_t k = 0;k<NELEMENTS(trigCase);k++)
+	{
+		uint64_t start,ticks;
+		double ns;
+
+		for(uint32_t i = 0;i<iterations/16;i++)
+			trigCase[k].run(i);
+		ticks = TRIG_TICKS();
+		start = HostNanos();
+		for(uint32_t i = 0;i<iterations;i++)
+			trigCase[k].run(i);
+		ns = (double)(HostNanos() - start)/iterations;
+		ticks = (TRIG_TICKS() - ticks)/iterations;
+		printf("%-16s %10.2f %10llu",trigCase[k].name,ns,(unsigned long long)ticks);
+		if(trigCase[k].error != NULL)
+		{
+			double maxErr = 0,sum2 = 0;
+			for(uint32_t i = 0;i<TRIG_SWEEP;i++)
+			{
+				double e = trigCase[k].error((i + 0.37)/TRIG_SWEEP);
+				maxErr = fmax(maxErr,fabs(e));
+				sum2 += e*e;
+			}
+			printf(" %10.3g %-3s %10.3g %-3s",maxErr,trigCase[k].unit,sqrt(sum2/TRIG_SWEEP),trigCase[k].unit);
+		}
+		printf("\n");
+	}
+
+	/* full-scale inputs, INT32_MIN has no positive counterpart */
+	{
+		static const int32_t edge[] = {INT32_MIN,INT32_MIN + 1,-1,0,1,INT32_MAX};
+		double maxErr = 0;
+		for(uint8_t i = 0;i<NELEMENTS(edge);i++)
+			for(uint8_t j = 0;j<NELEMENTS(edge);j++)
+			{
+				double e;
+				if(edge[i] == 0 && edge[j] == 0)
+					continue;
+				e = Atan2Q12(edge[i],edge[j]) - atan2(edge[i],edge[j])*VALUE_Q12/TRIG_2PI;
+				while(e > VALUE_Q12/2)	e -= VALUE_Q12;
+				while(e < -VALUE_Q12/2)	e += VALUE_Q12;
+				maxErr = fmax(maxErr,fabs(e));
+			}
+		printf("%-16s full-scale inputs max |err| %.3g step\n","Atan2Q12",maxErr);
+		if(maxErr > 1.0)
+			return 1;
+	}
+
+	if(curvePath != NULL && (curve = fopen(curvePath,"w")) != NULL)
+	{
+		fprintf(curve,"turn");
+		for(uint8_t k = 0;k<NELEMENTS(trigCase);k++)
+			if(trigCase[k].error != NULL)
+				fprintf(curve,",%s",trigCase[k].name);
+		fprintf(curve,"\n");
+		for(uint32_t i = 0;i<TRIG_SWEEP;i += 4)
+		{
+			double t = (i + 0.37)/TRIG_SWEEP;
+			fprintf(curve,"%.6f",t);
+			for(uint8_t k = 0;k<NELEMENTS(trigCase);k++)
+				if(trigCase[k].error != NULL)
+					fprintf(curve,",%.4g",trigCase[k].error(t));
+			fprintf(curve,"\n");
+		}
+		fclose(curve);
+	}
+	return 0;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# placement_map.py
+#
+# Lists the FAST_CODE (.ramfunc, SRAM) and FAST_DATA (.ccmram, CCM) symbols
+# of a linked image and bounds the flash stall they avoid.
+#
+# The bound is the cold-cache case: every 128-bit flash line of the moved
+# code is fetched once per ISR and each fetch costs FLASH_LATENCY wait
+# states. With the ART accelerator warm the real saving is lower; measure it
+# on the target with the DWT profiler.
+#
+#   placement_map.py [--objdump arm-none-eabi-objdump] [--ws 5]
+#                    [--hclk 168000000] [--pwm 20000] firmware.elf
+#
+
+import argparse
+import re
+import subprocess
+import sys
+
+SRAM = (0x20000000, 0x20020000)
+CCM = (0x10000000, 0x10010000)
+FLASH_LINE = 16
+
+SYMBOL = re.compile(r'^([0-9a-fA-F]+)\s(.{7})\s(\S+)\s+([0-9a-fA-F]+)\s+(.*)$')
+
+
+def in_range(addr, region):
+    return region[0] <= addr < region[1]
+
+
+def read_symbols(objdump, elf):
+    out = subprocess.run([objdump, '-t', elf], check=True,
+                         capture_output=True, text=True).stdout
+    code, data = [], []
+    for line in out.splitlines():
+        m = SYMBOL.match(line)
+        if not m:
+            continue
+        addr, flags, section, size, name = m.groups()
+        addr, size = int(addr, 16), int(size, 16)
+        if size == 0:
+            continue
+        # the host image keeps the input section names, the ARM image merges
+        # .ramfunc into .data, so fall back to the address there
+        if section == '.ramfunc' or ('F' in flags and in_range(addr, SRAM)):
+            code.append((name, size))
+        elif section == '.ccmram' or in_range(addr, CCM):
+            data.append((name, size))
+    return sorted(code, key=lambda s: -s[1]), sorted(data, key=lambda s: -s[1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--objdump', default='arm-none-eabi-objdump')
+    parser.add_argument('--ws', type=int, default=5, help='flash wait states')
+    parser.add_argument('--hclk', type=float, default=168e6)
+    parser.add_argument('--pwm', type=float, default=20000)
+    parser.add_argument('elf')
+    args = parser.parse_args()
+
+    code, data = read_symbols(args.objdump, args.elf)
+    if not code and not data:
+        sys.exit('no FAST_CODE/FAST_DATA symbols in %s' % args.elf)
+
+    print('FAST_CODE (.ramfunc -> SRAM)')
+    for name, size in code:
+        print('  %-32s %6u bytes' % (name, size))
+    code_bytes = sum(s for _, s in code)
+    print('  %-32s %6u bytes' % ('total', code_bytes))
+
+    print('FAST_DATA (.ccmram -> CCM)')
+    for name, size in data:
+        print('  %-32s %6u bytes' % (name, size))
+    data_bytes = sum(s for _, s in data)
+    print('  %-32s %6u bytes of %u' % ('total', data_bytes, CCM[1] - CCM[0]))
+
+    lines = (code_bytes + FLASH_LINE - 1) // FLASH_LINE
+    stall = lines * args.ws
+    budget = args.hclk / args.pwm
+    print('flash stall avoided per ISR (cold cache bound)')
+    print('  %u lines x %u WS = %u cycles, %.1f%% of the %.0f-cycle PWM period'
+          % (lines, args.ws, stall, 100.0 * stall / budget, budget))
+
+
+if __name__ == '__main__':
+    main()